@@ -0,0 +1,287 @@
+#ifndef CLASS_APUCHANNELS
+#define CLASS_APUCHANNELS
+
+#include <stdint.h>
+
+// sound channels of the APU
+// timers count CPU cycles down to their next clock, getTimer reports how far that is so
+// the APU can jump from one clock to the next instead of stepping every cycle
+// a channel that can not change its output reports no timer and is held still
+// channels hold no pointers so their state is saved as plain bytes
+
+// timer of a channel whose output can not change
+#define APU_NO_TIMER 0xffffffff
+
+// length counter load values indexed by bits 3-7 of the fourth register
+extern const uint8_t APULengthTable[32];
+
+// timer periods in cpu cycles for NTSC and PAL
+extern const uint16_t APUNoisePeriods[2][16];
+extern const uint16_t APUDMCRates[2][16];
+
+// volume envelope shared by the pulse and noise channels
+class APUEnvelope
+{
+private:
+
+    bool m_Start;
+    uint8_t m_Divider;
+    uint8_t m_Decay;
+
+public:
+
+    // fourth register write restarts the envelope
+    void restart() { m_Start = true;}
+
+    void reset();
+
+    // quarter frame
+    void clock(uint8_t reg)
+    {
+        if(m_Start)
+        {
+            m_Start = false;
+            m_Decay = 15;
+            m_Divider = reg & 0x0f;
+        }
+        else if(m_Divider) m_Divider--;
+        else
+        {
+            m_Divider = reg & 0x0f;
+            if(m_Decay) m_Decay--;
+            else if(reg & 0x20) m_Decay = 15; // loop
+        }
+    }
+
+    // constant volume or the decay level
+    uint8_t getVolume(uint8_t reg) { return (reg & 0x10) ? (reg & 0x0f) : m_Decay;}
+};
+
+class APUPulse
+{
+private:
+
+    // pulse 1 negates the sweep in ones complement
+    bool m_OnesComplement;
+
+    uint8_t m_Control; // duty, halt, volume
+    uint8_t m_Sweep;
+    uint16_t m_Period;
+    uint8_t m_Length;
+    bool m_Enabled;
+
+    APUEnvelope m_Envelope;
+    bool m_SweepReload;
+    uint8_t m_SweepDivider;
+    uint8_t m_Step; // position in the duty sequence
+
+    unsigned int m_Timer;
+
+    uint16_t getSweepTarget();
+    bool isMuted() { return m_Period < 8 || getSweepTarget() > 0x7ff;}
+
+public:
+
+    void reset(bool onescomplement);
+
+    // register 0 - 3 of the channel
+    void write(unsigned int reg, uint8_t val);
+    void setEnabled(bool enabled);
+    bool isActive() { return m_Length != 0;}
+
+    void clockQuarter() { m_Envelope.clock(m_Control);}
+    void clockHalf();
+
+    unsigned int getTimer()
+    {
+        if(!m_Length || isMuted() || !m_Envelope.getVolume(m_Control)) return APU_NO_TIMER;
+        return m_Timer;
+    }
+
+    // runs the timer cycles ahead, never past the reported timer
+    void advance(unsigned int cycles)
+    {
+        if(getTimer() == APU_NO_TIMER) return;
+
+        m_Timer -= cycles;
+        if(!m_Timer)
+        {
+            // the sequencer steps every other cpu cycle
+            m_Timer = (m_Period + 1) * 2;
+            m_Step = (m_Step + 1) & 7;
+        }
+    }
+
+    uint8_t getOutput();
+};
+
+class APUTriangle
+{
+private:
+
+    uint8_t m_Control; // halt and linear counter reload
+    uint16_t m_Period;
+    uint8_t m_Length;
+    bool m_Enabled;
+
+    uint8_t m_Linear;
+    bool m_LinearReload;
+    uint8_t m_Step;
+
+    unsigned int m_Timer;
+
+public:
+
+    void reset();
+
+    void write(unsigned int reg, uint8_t val);
+    void setEnabled(bool enabled);
+    bool isActive() { return m_Length != 0;}
+
+    void clockQuarter();
+    void clockHalf() { if(m_Length && !(m_Control & 0x80)) m_Length--;}
+
+    unsigned int getTimer()
+    {
+        // the sequence holds while either counter is out, ultrasonic periods hold as well
+        // rather than alias, the level they would average to is close to where they stop
+        if(!m_Length || !m_Linear || m_Period < 2) return APU_NO_TIMER;
+        return m_Timer;
+    }
+
+    void advance(unsigned int cycles)
+    {
+        if(getTimer() == APU_NO_TIMER) return;
+
+        m_Timer -= cycles;
+        if(!m_Timer)
+        {
+            m_Timer = m_Period + 1;
+            m_Step = (m_Step + 1) & 31;
+        }
+    }
+
+    uint8_t getOutput() { return (m_Step & 0x10) ? (m_Step & 0x0f) : (15 - m_Step);}
+};
+
+class APUNoise
+{
+private:
+
+    uint8_t m_Control;
+    uint8_t m_Mode; // mode and period index
+    uint8_t m_Length;
+    bool m_Enabled;
+
+    APUEnvelope m_Envelope;
+    uint16_t m_Shift;
+
+    bool m_PAL;
+    unsigned int m_Timer;
+
+public:
+
+    void reset();
+    void setRegion(bool pal);
+
+    void write(unsigned int reg, uint8_t val);
+    void setEnabled(bool enabled);
+    bool isActive() { return m_Length != 0;}
+
+    void clockQuarter() { m_Envelope.clock(m_Control);}
+    void clockHalf() { if(m_Length && !(m_Control & 0x20)) m_Length--;}
+
+    unsigned int getTimer()
+    {
+        if(!m_Length || !m_Envelope.getVolume(m_Control)) return APU_NO_TIMER;
+        return m_Timer;
+    }
+
+    void advance(unsigned int cycles)
+    {
+        if(getTimer() == APU_NO_TIMER) return;
+
+        m_Timer -= cycles;
+        if(!m_Timer)
+        {
+            m_Timer = APUNoisePeriods[m_PAL][m_Mode & 0x0f];
+
+            // feedback from bit 6 in short mode, bit 1 otherwise
+            uint16_t feedback = (m_Shift ^ (m_Shift >> ((m_Mode & 0x80) ? 6 : 1))) & 1;
+            m_Shift = (m_Shift >> 1) | (feedback << 14);
+        }
+    }
+
+    uint8_t getOutput() { return (m_Shift & 1) ? 0 : m_Envelope.getVolume(m_Control);}
+};
+
+// delta modulation channel
+// sample bytes are read by the APU through the cpu bus, the channel only asks for them
+class APUDMC
+{
+private:
+
+    uint8_t m_Control; // irq enable, loop, rate index
+    uint8_t m_Level;
+    uint16_t m_SampleAddress;
+    uint16_t m_SampleLength;
+
+    // memory reader
+    uint16_t m_Address;
+    uint16_t m_BytesRemaining;
+    uint8_t m_Buffer;
+    bool m_BufferFull;
+
+    // output unit
+    uint8_t m_Shift;
+    uint8_t m_BitsRemaining;
+    bool m_Silence;
+
+    bool m_IRQ;
+
+    bool m_PAL;
+    unsigned int m_Timer;
+
+    void restart();
+
+public:
+
+    void reset();
+    void setRegion(bool pal);
+
+    void write(unsigned int reg, uint8_t val);
+    void setEnabled(bool enabled);
+    bool isActive() { return m_BytesRemaining != 0;}
+
+    bool getIRQ() { return m_IRQ;}
+    void clearIRQ() { m_IRQ = false;}
+
+    // the sample buffer is empty and there are bytes left to read
+    bool needsSample() { return !m_BufferFull && m_BytesRemaining;}
+    uint16_t getSampleAddress() { return m_Address;}
+    void loadSample(uint8_t val);
+
+    unsigned int getTimer()
+    {
+        // idle once the last bits are out and nothing is left to play
+        if(m_Silence && !m_BufferFull && !m_BytesRemaining) return APU_NO_TIMER;
+        return m_Timer;
+    }
+
+    void advance(unsigned int cycles)
+    {
+        if(getTimer() == APU_NO_TIMER) return;
+
+        m_Timer -= cycles;
+        if(!m_Timer) clockTimer();
+    }
+
+    void clockTimer();
+
+    // cpu cycles until the next sample byte is read, APU_NO_TIMER if none is coming
+    unsigned int getFetchCycles();
+
+    uint8_t getOutput() { return m_Level;}
+};
+
+#endif // CLASS_APUCHANNELS
@@ -0,0 +1,47 @@
+#ifndef CLASS_AUDIORING
+#define CLASS_AUDIORING
+
+#include <atomic>
+#include <stdint.h>
+
+// default ring size in samples, about a third of a second at 48 kHz
+#define AUDIORING_DEFAULT_SIZE 16384
+
+// lock free ring of 16 bit samples with one producer and one consumer
+// the emulation thread writes whole frames, an audio callback reads from any thread
+// neither side blocks, a full ring drops the newest samples and an empty one returns less
+class AudioRing
+{
+private:
+
+    int16_t *m_Samples;
+
+    // capacity is a power of two so positions wrap with a mask
+    unsigned int m_Capacity;
+    unsigned int m_Mask;
+
+    // total samples written and read
+    std::atomic<uint64_t> m_Written;
+    std::atomic<uint64_t> m_Read;
+
+public:
+    // capacity is rounded up to a power of two
+    AudioRing(unsigned int capacity);
+    ~AudioRing();
+
+    // producer side, returns the number of samples stored
+    unsigned int write(const int16_t *samples, unsigned int count);
+
+    // consumer side, returns the number of samples copied
+    unsigned int read(int16_t *samples, unsigned int count);
+
+    // samples waiting to be read
+    unsigned int getAvailable();
+
+    // drop everything unread, only from the consumer side
+    void clear() { m_Read.store(m_Written.load(std::memory_order_acquire), std::memory_order_release);}
+
+    unsigned int getCapacity() { return m_Capacity;}
+};
+
+#endif // CLASS_AUDIORING
@@ -0,0 +1,80 @@
+#ifndef CLASS_BLIPBUFFER
+#define CLASS_BLIPBUFFER
+
+#include <stdint.h>
+
+// band limited step synthesis
+// level changes are added at clock resolution as steps shaped by a windowed sinc, so
+// the output only has to be computed at the sample rate instead of every clock
+// the buffer holds the derivative of the output, reading integrates it
+// steps are queued as they come and resampled a frame at a time through the polyphase
+// kernel, four taps per instruction where SSE is available
+#define BLIP_PHASE_BITS 6
+#define BLIP_PHASES (1 << BLIP_PHASE_BITS)
+#define BLIP_TAPS 16
+
+// samples a frame can hold before it must be read
+#define BLIP_MAX_SAMPLES 4096
+
+// steps queued before they are resampled, a frame usually has far fewer
+#define BLIP_MAX_DELTAS 8192
+
+class BlipBuffer
+{
+private:
+
+    // clock to sample position, 32.32 fixed point
+    uint64_t m_Factor;
+
+    // sample position of clock 0 of the current frame
+    uint64_t m_Offset;
+
+    float m_Buffer[BLIP_MAX_SAMPLES + BLIP_TAPS];
+
+    // impulse response per sub sample phase, each sums to 1
+    alignas(16) float m_Kernel[BLIP_PHASES][BLIP_TAPS];
+
+    // steps not yet resampled
+    struct Delta
+    {
+        unsigned int clock;
+        float delta;
+    };
+    Delta m_Deltas[BLIP_MAX_DELTAS];
+    unsigned int m_DeltaCount;
+
+    // add the queued steps to the buffer
+    void flushDeltas();
+
+    // integrator and dc blocking filter state
+    float m_Accumulator;
+    float m_FilterIn;
+    float m_FilterOut;
+
+public:
+    BlipBuffer();
+
+    void setRates(double clockrate, double samplerate);
+    void clear();
+
+    // add a step of delta at clock, counted from the start of the frame
+    void addDelta(unsigned int clock, float delta)
+    {
+        if(m_DeltaCount == BLIP_MAX_DELTAS) flushDeltas();
+
+        m_Deltas[m_DeltaCount].clock = clock;
+        m_Deltas[m_DeltaCount].delta = delta;
+        m_DeltaCount++;
+    }
+
+    // end the frame after clocks, its samples become readable and the next frame starts at 0
+    void endFrame(unsigned int clocks);
+
+    // complete samples waiting to be read
+    unsigned int getAvailable() { return m_Offset >> 32;}
+
+    // read up to count samples scaled to 16 bit, returns the number read
+    unsigned int readSamples(int16_t *out, unsigned int count);
+};
+
+#endif // CLASS_BLIPBUFFER
@@ -5,6 +5,10 @@
 #include <iostream>
 #include <vector>
 
+#include "memorymap.hpp"
+#include "c6502.hpp"
+#include "tiledecoder.hpp"
+
 // define PPU registers
 #define PPUCTRL 0x2000
 #define PPUMASK 0x2001
@@ -16,36 +20,217 @@
 #define PPUDATA 0x2007
 #define OAMDMA 0x4014
 
-class C2C02
+// PPUCTRL bits
+#define PPUCTRL_NAMETABLE 0x03
+#define PPUCTRL_INCREMENT 0x04
+#define PPUCTRL_SPRITE_TABLE 0x08
+#define PPUCTRL_BG_TABLE 0x10
+#define PPUCTRL_SPRITE_SIZE 0x20
+#define PPUCTRL_NMI 0x80
+
+// PPUMASK bits
+#define PPUMASK_BG_LEFT 0x02
+#define PPUMASK_SPRITES_LEFT 0x04
+#define PPUMASK_BG 0x08
+#define PPUMASK_SPRITES 0x10
+
+// PPUSTATUS bits
+#define PPUSTATUS_OVERFLOW 0x20
+#define PPUSTATUS_SPRITE0 0x40
+#define PPUSTATUS_VBLANK 0x80
+
+// PPU memory
+#define PALETTE_START 0x3f00
+
+// nametable layout
+enum MIRRORING{ MIRROR_HORIZONTAL, MIRROR_VERTICAL, MIRROR_SINGLE_LOW, MIRROR_SINGLE_HIGH, MIRROR_FOUR_SCREEN};
+
+// frame buffer
+#define SCREEN_WIDTH 256
+#define SCREEN_HEIGHT 240
+
+// pattern tables 0x0000 - 0x1fff
+#define PATTERN_TILES 512
+
+// frame timing
+#define DOTS_PER_SCANLINE 341
+#define VBLANK_SCANLINE 241
+#define SCANLINES_NTSC 262
+#define SCANLINES_PAL 312
+
+// master clock dividers, NTSC runs 3 dots per CPU cycle, PAL 3.2
+#define CPU_DIVIDER_NTSC 12
+#define PPU_DIVIDER_NTSC 4
+#define CPU_DIVIDER_PAL 16
+#define PPU_DIVIDER_PAL 5
+
+// receives rising edges of PPU address line A12, used by cartridge scanline counters
+class A12Listener
+{
+public:
+    virtual ~A12Listener() {}
+
+    virtual void a12Rise() = 0;
+};
+
+class C2C02 : public MemoryHandler
 {
 private:
 
     // memory
-    uint8_t **m_Mem;
+    MemoryMap *m_Mem;
     unsigned int m_MemSize;
 
     // PPU registers
-    uint8_t *m_PPUCTRL;
-    uint8_t *m_PPUMASK;
-    uint8_t *m_PPUSTATUS;
-    uint8_t *m_OAMADDR;
-    uint8_t *m_OAMDATA;
-    uint8_t *m_PPUSCROLL;
-    uint8_t *m_PPUADDR;
-    uint8_t *m_PPUDATA;
-    uint8_t *m_OAMDMA;
+    uint8_t m_PPUCTRL;
+    uint8_t m_PPUMASK;
+    uint8_t m_PPUSTATUS;
+    uint8_t m_OAMADDR;
+
+    // internal registers
+    // v = current vram address, t = temporary vram address (top left of screen)
+    // yyy NN YYYYY XXXXX - fine y, nametable, coarse y, coarse x
+    uint16_t m_VRAMAddr;
+    uint16_t m_TempAddr;
+    uint8_t m_FineX;
+    bool m_WriteToggle; // first / second write of PPUSCROLL and PPUADDR
+
+    uint8_t m_ReadBuffer; // PPUDATA reads below the palette are delayed by one read
+    uint8_t m_IOLatch; // last value written to a register, returned by write only registers
+
+    // object attribute memory, 64 sprites x 4 bytes
+    uint8_t m_OAM[256];
+
+    // palette ram, 0x3f00 - 0x3f1f mirrored to 0x3fff
+    uint8_t m_Palette[32];
+
+    // current nametable layout
+    MIRRORING m_Mirroring;
+
+    // CPU the PPU is clocked against, receives the vblank nmi
+    C6502 *m_CPU;
+
+    // timing, the PPU lags the CPU until catchUp is called
+    bool m_PAL;
+    unsigned int m_CPUDivider;
+    unsigned int m_PPUDivider;
+    unsigned int m_ScanlinesPerFrame;
+    uint64_t m_Clock; // master clock ticks the PPU has run
+    unsigned int m_Scanline; // 0 - 239 visible, 241 vblank, last line is the pre-render line
+    unsigned int m_Dot; // next dot to run on the scanline
+    uint64_t m_Frame; // frames since reset
+    uint64_t m_ScanlineCount; // scanlines completed since reset
+    uint64_t m_FrameStartClock; // master clock at dot 0 of the current frame
+
+    void runDots(unsigned int dots);
 
+    // CPU cycle a number of dots from the PPU's current position falls in
+    uint64_t dotsToCycle(unsigned int dots);
+
+    // A12 rises once per rendered line when sprites and background use different pattern tables
+    A12Listener *m_A12Listener;
+    bool m_A12; // A12 of the last CPU access through PPUDATA
+    unsigned int getA12RiseDot();
+    void updateCPUA12();
+
+    // rendering, one NES color index (0 - 63) per pixel
+    uint8_t m_FrameBuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+    unsigned int m_RenderX; // pixels of the current scanline already drawn
+    bool m_BGOpaque[SCREEN_WIDTH]; // background pixels of the current scanline that are not transparent
+
+    bool isRendering() { return m_PPUMASK & (PPUMASK_BG | PPUMASK_SPRITES);}
+
+    // draw the current scanline up to endx, split so mid scanline register writes take effect
+    void renderBackground(unsigned int endx);
+    void renderToCurrentDot();
+
+    // select up to 8 sprites for the next scanline and draw them over the current one
+    void evaluateSprites();
+    void renderSprites();
+
+    // copy a 256 byte CPU page to OAM
+    void oamDMA(uint8_t page);
+
+    // decoded pattern table tiles, palette index form, keyed by tile address >> 4
+    uint8_t m_TileCache[PATTERN_TILES][TILE_PIXELS];
+    bool m_TileValid[PATTERN_TILES];
+    const uint8_t *getTile(uint16_t address);
+
+    // loopy v increments while rendering
+    void incrementX();
+    void incrementY();
+
+    // sprites on the next scanline, built once per line by evaluateSprites
+    struct LineSprite
+    {
+        uint8_t y;
+        uint8_t tile;
+        uint8_t attr;
+        uint8_t x;
+    };
+    LineSprite m_LineSprites[8];
+    unsigned int m_LineSpriteCount;
+    bool m_LineHasSprite0;
+
+    // CPU memory, source of OAM DMA
+    MemoryMap *m_CPUMem;
+
+    // PPU address space access, palette is internal to the PPU
+    uint8_t ppuRead(uint16_t address);
+    void ppuWrite(uint16_t address, uint8_t val);
 
     bool init();
 
 public:
-    C2C02(uint8_t **memory, unsigned int memory_size);
+    C2C02(MemoryMap *memory);
     ~C2C02();
 
-    // map PPU registers to CPU memory
-    void mapRegisters(uint8_t **cpumem);
+    // map PPU registers and OAM DMA to CPU memory
+    void mapRegisters(MemoryMap *cpumem);
     void reset();
 
+    // registers, OAM, palette, nametables and timing, the frame buffer is not saved
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    // clock source
+    void connectCPU(C6502 *cpu) { m_CPU = cpu;}
+    void setRegion(bool pal);
+
+    // run the PPU up to the CPU's current cycle
+    void catchUp();
+
+    // catch up and draw the current scanline so far, before anything rendering reads changes
+    void sync();
+
+    // CPU cycle of the next vblank or frame start, the scheduler runs the CPU no further
+    uint64_t getNextEventCycle();
+
+    // scanline counter on the cartridge
+    void setA12Listener(A12Listener *listener) { m_A12Listener = listener;}
+
+    // CPU cycle of the nth A12 rise from now assuming rendering stays as it is, NO_EVENT if none
+    uint64_t getA12RiseCycle(unsigned int rises);
+
+    // map nametables 0x2000 - 0x3fff onto the 2KB of PPU ram
+    void setMirroring(MIRRORING mirroring);
+
+    // drop cached tiles after CHR ram writes or CHR bank switches
+    void invalidateTiles(uint16_t startaddress, uint16_t endaddress);
+
+    const uint8_t *getFrameBuffer() const { return m_FrameBuffer;}
+    bool saveFrame(std::string filename);
+
+    uint64_t getFrame() { return m_Frame;}
+    uint64_t getScanlineCount() { return m_ScanlineCount;}
+    uint64_t getFrameStartCycle() { return m_FrameStartClock / m_CPUDivider;}
+    unsigned int getScanline() { return m_Scanline;}
+    unsigned int getDot() { return m_Dot;}
+
+    // CPU access to the PPU registers
+    uint8_t memRead(uint16_t address);
+    void memWrite(uint16_t address, uint8_t val);
+
     // debug
     void debugConsole(std::string prompt);
     void show();
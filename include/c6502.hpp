@@ -5,8 +5,25 @@
 #include <iostream>
 #include <vector>
 
+#include "memorymap.hpp"
+#include "cputrace.hpp"
+#include "savestate.hpp"
+
 #define STACK_END 0x0100
 
+// interrupt vectors
+#define NMI_VECTOR 0xfffa
+#define RESET_VECTOR 0xfffc
+#define IRQ_VECTOR 0xfffe
+
+// interrupt request lines, the irq is asserted while any line is held
+#define IRQ_APU_FRAME 0x01
+#define IRQ_APU_DMC 0x02
+#define IRQ_MAPPER 0x04
+
+// event cycle when no event is pending
+#define NO_EVENT 0xffffffffffffffffULL
+
     // b7 = S - Sign flag, 1 = negative
     // b6 = V - overflow flag
     // b5 = not used, should always be logical 1
@@ -24,12 +41,28 @@ enum ADDRESS_MODE{IMMEDIATE, ZERO_PAGE, ZERO_PAGE_X, ZERO_PAGE_Y, ABSOLUTE, ABSO
 // op codes implemented in c6502_ops.cpp
 // debug console implemented in c6502_debug.cpp
 
+class C6502;
+
+// operation handler, one instantiation per operation and addressing mode
+typedef void (C6502::*C6502Operation)();
+
+// opcode dispatch table entry
+struct C6502Instruction
+{
+    C6502Operation op; // NULL if opcode is undefined
+    const char *name;
+    ADDRESS_MODE amode;
+    uint8_t bytes; // instruction length including opcode
+    uint8_t cycles; // base cycle count
+    bool pagePenalty; // +1 cycle if indexed address crosses a page boundary
+};
+
 class C6502
 {
 protected:
 
     // memory
-    uint8_t **m_Mem;
+    MemoryMap *m_Mem;
     unsigned int m_MemSize;
 
     // memory map
@@ -56,12 +89,16 @@ protected:
     void pushStack(uint8_t val);
     uint8_t popStack();
 
-    uint8_t m_ImmediateTemp; // temporary storage for immediate addressing mode
-
     // status register
     uint8_t m_RegStat;
-    bool getFlag(STAT_FLAG flag);
-    void setFlag(STAT_FLAG flag, bool on);
+    bool getFlag(STAT_FLAG flag) { return (m_RegStat >> flag) & 0x1;}
+    void setFlag(STAT_FLAG flag, bool on)
+    {
+        if(flag == FLAG_NOT_USED) return;
+
+        if(on) m_RegStat |= (0x1 << flag);
+        else m_RegStat &= ~(0x1 << flag);
+    }
     // b7 = N - Sign flag, 1 = negative
     // b6 = V - overflow flag
     // b5 = not used, should always be logical 1
@@ -73,78 +110,135 @@ protected:
 
     bool execute(uint8_t opcode);
 
-    // address mode
-    uint8_t *getAddress(ADDRESS_MODE amode);
-
-    // counter for an operation's cycle burn time
-    unsigned int m_Cycles;
-
-    // operations
-    void ADC(ADDRESS_MODE amode); // add accumulator + operand + carry -> accumulator
-    void AND(ADDRESS_MODE amode); // and memory with accumulator -> accumulator
-    void ASL(ADDRESS_MODE amode); // shift accumulator or memory left <<
-    void BCC(ADDRESS_MODE amode); // branch on carry clear, branch if carry flag == 0
-    void BCS(ADDRESS_MODE amode); // branch on carry set, branch if carry flag == 1
-    void BEQ(ADDRESS_MODE amode); // branch on result zero, branch if zero flag == 1
-    void BIT(ADDRESS_MODE amode); // bit - test bits in memory with accumulator
-    void BMI(ADDRESS_MODE amode); // branch on result minus, n == 1
-    void BNE(ADDRESS_MODE amode); // branch on results not zero, z == 0
-    void BPL(ADDRESS_MODE amode); // branch on result plus, n == 0
-    void BRK(ADDRESS_MODE amode); // break, force break
-    void BVC(ADDRESS_MODE amode); // branch on overflow clear, v == 0
-    void BVS(ADDRESS_MODE amode); // branch on overflow set, v == 1
-    void CLC(ADDRESS_MODE amode); // clear carry flag, c = 0
-    void CLD(ADDRESS_MODE amode); // clear decimal mode, d = 0
-    void CLI(ADDRESS_MODE amode); // clear interrupt disable flag, i = 0
-    void CLV(ADDRESS_MODE amode); // clear overflow flag, v = 0
-    void CMP(ADDRESS_MODE amode); // compare memory and accumulator, a - m
-    void CPX(ADDRESS_MODE amode); // compare memory and  x, x - m
-    void CPY(ADDRESS_MODE amode); // compare memory and y, y - m
-    void DEC(ADDRESS_MODE amode); // decrement memory by 1, m--
-    void DEX(ADDRESS_MODE amode); // decrement register x by 1
-    void DEY(ADDRESS_MODE amode); // decrement register y by 1
-    void EOR(ADDRESS_MODE amode); // exclusive or mem with accumulator, a ^ m -> a
-    void INC(ADDRESS_MODE amode); // increment memory by 1, m++
-    void INX(ADDRESS_MODE amode); // increment register x by 1, regx++
-    void INY(ADDRESS_MODE amode); // increment register y by 1, regy++
-    void JMP(ADDRESS_MODE amode); // jump to new location
-    void JSR(ADDRESS_MODE amode); // jump and save return address to stack
-    void LDA(ADDRESS_MODE amode); // load accumulator with memory, m -> a
-    void LDX(ADDRESS_MODE amode); // load register x with memory, m -> reg x
-    void LDY(ADDRESS_MODE amode); // load register y with memory, m -> reg y
-    void LSR(ADDRESS_MODE amode); // shift right one bit, m | a >> 1
-    void NOP(ADDRESS_MODE amode); // no operation (2 cycles)
-    void ORA(ADDRESS_MODE amode); // or memory with accumulator a|m -> a
-    void PHA(ADDRESS_MODE amode); // push accumulator on stack
-    void PHP(ADDRESS_MODE amode); // push status register on stack
-    void PLA(ADDRESS_MODE amode); // pull accumulator from stack
-    void PLP(ADDRESS_MODE amode); // pull status register from stack
-    void ROL(ADDRESS_MODE amode); // rotate one bit left (memory or accumulator)
-    void ROR(ADDRESS_MODE amode); // rotate one bit right (memory or accumulator)
-    void RTI(ADDRESS_MODE amode); // return from interrupt
-    void RTS(ADDRESS_MODE amode); // return from subroutine
-    void SBC(ADDRESS_MODE amode); // subtract memory from accumulator with borrow
-    void SEC(ADDRESS_MODE amode); // set carry flag
-    void SED(ADDRESS_MODE amode); // set decimal mode
-    void SEI(ADDRESS_MODE amode); // set interrupt disable status
-    void STA(ADDRESS_MODE amode); // store accumulator in memory
-    void STX(ADDRESS_MODE amode); // store register x in memory
-    void STY(ADDRESS_MODE amode); // store register y in memory
-    void TAX(ADDRESS_MODE amode); // transfer accumulator to reg x
-    void TAY(ADDRESS_MODE amode); // transfer accumulator to reg y
-    void TSX(ADDRESS_MODE amode); // transfer stack pointer to reg x
-    void TXA(ADDRESS_MODE amode); // transfer reg x to accumulator
-    void TXS(ADDRESS_MODE amode); // transfer reg x to stack pointer
-    void TYA(ADDRESS_MODE amode); // transfer reg y to accumulator
+    // opcode dispatch table, built once on first use
+    // initOpTable builds it through a function local static so cpus constructed on several
+    // threads at once do not race
+    static C6502Instruction m_OpTable[256];
+    static void initOpTable();
+    static bool buildOpTable();
+    static void setOp(uint8_t opcode, C6502Operation op, const char *name, ADDRESS_MODE amode, uint8_t bytes,
+                      uint8_t cycles, bool pagePenalty = false);
+
+    // address of the instruction being executed, PC is advanced past it before the operation runs
+    uint16_t m_InstPC;
+
+    // set by getAddress when an indexed address crosses a page boundary
+    bool m_PageCrossed;
+
+    // memory access
+    uint8_t read(uint16_t address) { return m_Mem->busRead(address);}
+    void write(uint16_t address, uint8_t val) { m_Mem->busWrite(address, val);}
+
+    // effective address of the operand, specialized per address mode in c6502_ops.cpp
+    template<ADDRESS_MODE amode> uint16_t getAddress();
+
+    // relative branch to operand if condition is true
+    void branch(bool condition);
+
+    // interrupts, nmi is edge triggered and latched, irq is level triggered
+    bool m_NMIPending;
+    uint8_t m_IRQLines;
+
+    // push pc and status, then jump through vector
+    void interrupt(uint16_t vector, bool brk);
+
+    // set when an undefined opcode stops the processor
+    bool m_Jammed;
+
+    // cycle the current run stops at
+    uint64_t m_RunTarget;
+
+    // cycles since reset, 64 bit so it never wraps in a session
+    uint64_t m_Cycles;
+
+    // cycles of the last DMA halt, DMA landing inside it overlaps rather than halts again
+    uint64_t m_HaltStart;
+    uint64_t m_HaltEnd;
+
+    // instructions executed since reset
+    uint64_t m_Instructions;
+
+    // optional instruction trace, NULL when off
+    CPUTrace *m_Trace;
+
+    // shared arithmetic for memory and accumulator forms
+    uint8_t shiftLeft(uint8_t val);
+    uint8_t shiftRight(uint8_t val);
+    uint8_t rotateLeft(uint8_t val);
+    uint8_t rotateRight(uint8_t val);
+    void compare(uint8_t reg, uint8_t val);
+    void addWithCarry(uint8_t val);
+    void pullStatus()
+    {
+        m_RegStat = (popStack() & ~(0x1 << FLAG_SOFTWARE_INTERRUPT)) | (0x1 << FLAG_NOT_USED);
+    }
+
+    // operations, templated on the address mode
+    template<ADDRESS_MODE amode> void ADC(); // add accumulator + operand + carry -> accumulator
+    template<ADDRESS_MODE amode> void AND(); // and memory with accumulator -> accumulator
+    template<ADDRESS_MODE amode> void ASL(); // shift accumulator or memory left <<
+    template<ADDRESS_MODE amode> void BCC(); // branch on carry clear, branch if carry flag == 0
+    template<ADDRESS_MODE amode> void BCS(); // branch on carry set, branch if carry flag == 1
+    template<ADDRESS_MODE amode> void BEQ(); // branch on result zero, branch if zero flag == 1
+    template<ADDRESS_MODE amode> void BIT(); // bit - test bits in memory with accumulator
+    template<ADDRESS_MODE amode> void BMI(); // branch on result minus, n == 1
+    template<ADDRESS_MODE amode> void BNE(); // branch on results not zero, z == 0
+    template<ADDRESS_MODE amode> void BPL(); // branch on result plus, n == 0
+    template<ADDRESS_MODE amode> void BRK(); // break, force break
+    template<ADDRESS_MODE amode> void BVC(); // branch on overflow clear, v == 0
+    template<ADDRESS_MODE amode> void BVS(); // branch on overflow set, v == 1
+    template<ADDRESS_MODE amode> void CLC(); // clear carry flag, c = 0
+    template<ADDRESS_MODE amode> void CLD(); // clear decimal mode, d = 0
+    template<ADDRESS_MODE amode> void CLI(); // clear interrupt disable flag, i = 0
+    template<ADDRESS_MODE amode> void CLV(); // clear overflow flag, v = 0
+    template<ADDRESS_MODE amode> void CMP(); // compare memory and accumulator, a - m
+    template<ADDRESS_MODE amode> void CPX(); // compare memory and  x, x - m
+    template<ADDRESS_MODE amode> void CPY(); // compare memory and y, y - m
+    template<ADDRESS_MODE amode> void DEC(); // decrement memory by 1, m--
+    template<ADDRESS_MODE amode> void DEX(); // decrement register x by 1
+    template<ADDRESS_MODE amode> void DEY(); // decrement register y by 1
+    template<ADDRESS_MODE amode> void EOR(); // exclusive or mem with accumulator, a ^ m -> a
+    template<ADDRESS_MODE amode> void INC(); // increment memory by 1, m++
+    template<ADDRESS_MODE amode> void INX(); // increment register x by 1, regx++
+    template<ADDRESS_MODE amode> void INY(); // increment register y by 1, regy++
+    template<ADDRESS_MODE amode> void JMP(); // jump to new location
+    template<ADDRESS_MODE amode> void JSR(); // jump and save return address to stack
+    template<ADDRESS_MODE amode> void LDA(); // load accumulator with memory, m -> a
+    template<ADDRESS_MODE amode> void LDX(); // load register x with memory, m -> reg x
+    template<ADDRESS_MODE amode> void LDY(); // load register y with memory, m -> reg y
+    template<ADDRESS_MODE amode> void LSR(); // shift right one bit, m | a >> 1
+    template<ADDRESS_MODE amode> void NOP(); // no operation (2 cycles)
+    template<ADDRESS_MODE amode> void ORA(); // or memory with accumulator a|m -> a
+    template<ADDRESS_MODE amode> void PHA(); // push accumulator on stack
+    template<ADDRESS_MODE amode> void PHP(); // push status register on stack
+    template<ADDRESS_MODE amode> void PLA(); // pull accumulator from stack
+    template<ADDRESS_MODE amode> void PLP(); // pull status register from stack
+    template<ADDRESS_MODE amode> void ROL(); // rotate one bit left (memory or accumulator)
+    template<ADDRESS_MODE amode> void ROR(); // rotate one bit right (memory or accumulator)
+    template<ADDRESS_MODE amode> void RTI(); // return from interrupt
+    template<ADDRESS_MODE amode> void RTS(); // return from subroutine
+    template<ADDRESS_MODE amode> void SBC(); // subtract memory from accumulator with borrow
+    template<ADDRESS_MODE amode> void SEC(); // set carry flag
+    template<ADDRESS_MODE amode> void SED(); // set decimal mode
+    template<ADDRESS_MODE amode> void SEI(); // set interrupt disable status
+    template<ADDRESS_MODE amode> void STA(); // store accumulator in memory
+    template<ADDRESS_MODE amode> void STX(); // store register x in memory
+    template<ADDRESS_MODE amode> void STY(); // store register y in memory
+    template<ADDRESS_MODE amode> void TAX(); // transfer accumulator to reg x
+    template<ADDRESS_MODE amode> void TAY(); // transfer accumulator to reg y
+    template<ADDRESS_MODE amode> void TSX(); // transfer stack pointer to reg x
+    template<ADDRESS_MODE amode> void TXA(); // transfer reg x to accumulator
+    template<ADDRESS_MODE amode> void TXS(); // transfer reg x to stack pointer
+    template<ADDRESS_MODE amode> void TYA(); // transfer reg y to accumulator
 
     void printError(std::string errormsg);
 
 public:
-    C6502(uint8_t **memory, unsigned int memory_size);
+    C6502(MemoryMap *memory);
     virtual ~C6502();
 
-    //uint16_t getProgramCounter() { return m_RegPC;}
-    //void setProgramCounter(uint16_t newpc) { m_RegPC = newpc;}
+    uint16_t getProgramCounter() { return m_RegPC;}
+    void setProgramCounter(uint16_t newpc) { m_RegPC = newpc;}
 
     //uint8_t getStackPointer() { return m_RegSP;}
     //void setStackPointer(uint8_t newsp) { m_RegSP = newsp;}
@@ -152,10 +246,50 @@ public:
     // reset CPU
     bool reset();
 
+    // registers, cycle clock and interrupt state
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
     // execute
     bool executeNextInstruction();
 
+    // execute instructions until the cycle count reaches target, servicing interrupts
+    // returns false if the processor jammed
+    bool run(uint64_t targetcycles);
+
+    // stop run after the current instruction, used when a predicted event moves
+    void endSlice() { m_RunTarget = 0;}
+
+    uint64_t getCycles() { return m_Cycles;}
+
+    // cycles the CPU is halted for by OAM DMA, added to the count as one adjustment
+    void stall(unsigned int cycles)
+    {
+        m_HaltStart = m_Cycles;
+        m_Cycles += cycles;
+        m_HaltEnd = m_Cycles;
+    }
+    uint64_t getInstructionCount() { return m_Instructions;}
+    bool isJammed() { return m_Jammed;}
+
+    // record every instruction into trace, NULL to stop, the trace is not owned
+    void setTrace(CPUTrace *trace) { m_Trace = trace;}
+    CPUTrace *getTrace() { return m_Trace;}
+
+    static const char *getOpName(uint8_t opcode);
+
+    void triggerNMI() { m_NMIPending = true;}
+    void setIRQLine(uint8_t line, bool asserted)
+    {
+        if(asserted) m_IRQLines |= line;
+        else m_IRQLines &= ~line;
+    }
+
     virtual void debugConsole(std::string prompt);
     void show();
+
+    // next instruction in nestest.log layout, up to and including the stack pointer
+    // C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD
+    std::string getTraceLine();
 };
 #endif // CLASS_C6502
@@ -2,6 +2,14 @@
 #define CLASS_CARTRIDGE
 
 #include <string>
+#include <stdint.h>
+
+#include "romimage.hpp"
+
+#define INES_HEADER_SIZE 16
+#define TRAINER_SIZE 512
+#define PRG_BANK_SIZE 0x4000
+#define CHR_BANK_SIZE 0x2000
 
 class Cartridge
 {
@@ -9,26 +17,53 @@ private:
 
     uint8_t m_Header[16];
 
-    uint8_t *m_Trainer;
-    uint8_t *m_PRGROM;
-    uint8_t *m_CHRROM;
+    // whole rom file, shared read only, PRG and CHR point into it
+    ROMImage *m_ROMImage;
+    const uint8_t *m_ROMData;
+    unsigned int m_ROMDataSize;
+
+    const uint8_t *m_Trainer;
+    const uint8_t *m_PRGROM;
+    const uint8_t *m_CHRROM;
     //uint8_t *m_PC_INST-ROM;
     //uint8_t *m_PC_PROM;
 
+    // sizes in bytes parsed from the header
+    unsigned int m_PRGROMSize;
+    unsigned int m_CHRROMSize;
+    unsigned int m_PRGRAMSize;
+    unsigned int m_CHRRAMSize;
+
+    bool m_NES2;
+    uint16_t m_Mapper;
+    uint8_t m_SubMapper;
+
     std::string m_ROMFileName;
     bool m_LoadedSuccessfully;
 
+    bool parseHeader();
+
+    // NES 2.0 rom size, lsb is the header byte, msb the size nibble
+    // false if the size does not fit 32 bits
+    static bool getNES2ROMSize(uint8_t lsb, uint8_t msb, unsigned int banksize, unsigned int &size);
+
 public:
     Cartridge(std::string romfile);
     ~Cartridge();
 
     bool loadSuccessful() { return m_LoadedSuccessfully;}
 
-    int getPRGROMSizeByte() { return m_Header[4];}
-    int getCHRROMSizeByte() { return m_Header[5];}
+    // sizes in bytes
+    unsigned int getPRGROMSize() { return m_PRGROMSize;}
+    unsigned int getCHRROMSize() { return m_CHRROMSize;}
+    unsigned int getPRGRAMSize() { return m_PRGRAMSize;}
+    unsigned int getCHRRAMSize() { return m_CHRRAMSize;}
 
     const uint8_t *getPRGROM() const { return m_PRGROM;}
     const uint8_t *getCHRROM() const { return m_CHRROM;}
+    const uint8_t *getTrainer() const { return m_Trainer;}
+
+    bool isNES2() { return m_NES2;}
 
     // flag 6
     bool isVerticallyMirrored() { return m_Header[6] & 0x1;} // false = horizontally mirrored
@@ -36,15 +71,16 @@ public:
     bool hasTrainerData() { return m_Header[6] & 0x4;} // 0x7000 - 0x71ff
     bool IgnoreMirroring() { return m_Header[6] & 0x8;} // ignore mirror control, provide four-screen vram
 
-    // flag 6 & 7 - mapper number
-    uint8_t getMapperNumber() { return (m_Header[6] >> 4) + (m_Header[7] & 0xf0);}
+    // flag 6, 7 and NES 2.0 flag 8 - mapper number
+    uint16_t getMapperNumber() { return m_Mapper;}
+    uint8_t getSubMapperNumber() { return m_SubMapper;}
 
     // flag 7
     bool VSUnisystem() { return m_Header[7] & 0x1;}
     bool PlayChoice10() { return m_Header[7] & 0x2;}
 
-    // flag 9
-    bool isPAL() { return m_Header[9] & 0x1;}
+    // flag 9, NES 2.0 flag 12
+    bool isPAL() { return m_NES2 ? ( (m_Header[12] & 0x3) == 0x1) : (m_Header[9] & 0x1);}
 
     // flag 10
     int getVideoType() { return m_Header[10] & 0x3;}
@@ -0,0 +1,42 @@
+#ifndef CLASS_CONTROLLERS
+#define CLASS_CONTROLLERS
+
+#include "memorymap.hpp"
+#include "savestate.hpp"
+
+// controller registers
+#define JOYPAD1 0x4016
+#define JOYPAD2 0x4017
+
+// standard controller buttons in shift register order
+enum BUTTON{ BUTTON_A, BUTTON_B, BUTTON_SELECT, BUTTON_START, BUTTON_UP, BUTTON_DOWN, BUTTON_LEFT, BUTTON_RIGHT};
+
+class ControllerPorts : public MemoryHandler
+{
+private:
+
+    // current button state per port, bit n = button n
+    uint8_t m_Buttons[2];
+
+    // serial shift register per port, reloaded while strobe is high
+    uint8_t m_Shift[2];
+    bool m_Strobe;
+
+public:
+    ControllerPorts();
+    ~ControllerPorts();
+
+    // 0x4016 read / write, 0x4017 read only (writes go to the APU frame counter)
+    void mapRegisters(MemoryMap *cpumem);
+
+    void setButtons(int port, uint8_t buttons);
+    void reset();
+
+    // shift registers and strobe, button state belongs to the caller
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    uint8_t memRead(uint16_t address);
+    void memWrite(uint16_t address, uint8_t val);
+};
+#endif // CLASS_CONTROLLERS
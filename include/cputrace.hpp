@@ -0,0 +1,90 @@
+#ifndef CLASS_CPUTRACE
+#define CLASS_CPUTRACE
+
+#include <string>
+#include <iostream>
+#include <atomic>
+#include <stdint.h>
+
+#define CPUTRACE_MAGIC "NESTRACE"
+#define CPUTRACE_VERSION 1
+
+// state of the CPU before an instruction executes
+struct CPUTraceRecord
+{
+    uint64_t cycles;
+    uint16_t pc;
+    uint8_t opcode;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t p;
+    uint8_t sp;
+};
+
+// trace file header, followed by count records oldest first
+struct CPUTraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordsize;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+// fixed size ring of the most recent instructions
+// the emulation thread is the only writer and never blocks, readers copy out the
+// tail of the ring from any thread and drop records overwritten while copying
+class CPUTrace
+{
+private:
+
+    CPUTraceRecord *m_Records;
+
+    // capacity is a power of two so the write position wraps with a mask
+    unsigned int m_Capacity;
+    unsigned int m_Mask;
+
+    // total records written, the next record goes to m_Written & m_Mask
+    std::atomic<uint64_t> m_Written;
+
+public:
+    // capacity is rounded up to a power of two
+    CPUTrace(unsigned int capacity);
+    ~CPUTrace();
+
+    void record(uint64_t cycles, uint16_t pc, uint8_t opcode, uint8_t a, uint8_t x, uint8_t y, uint8_t p, uint8_t sp)
+    {
+        uint64_t n = m_Written.load(std::memory_order_relaxed);
+        CPUTraceRecord &r = m_Records[n & m_Mask];
+
+        r.cycles = cycles;
+        r.pc = pc;
+        r.opcode = opcode;
+        r.a = a;
+        r.x = x;
+        r.y = y;
+        r.p = p;
+        r.sp = sp;
+
+        m_Written.store(n + 1, std::memory_order_release);
+    }
+
+    void clear() { m_Written.store(0, std::memory_order_release);}
+
+    unsigned int getCapacity() { return m_Capacity;}
+    uint64_t getWritten() { return m_Written.load(std::memory_order_acquire);}
+
+    // copy up to count of the most recent records into buf, oldest first
+    // returns the number of records copied, a full ring gives one less as the slot the
+    // writer fills next may be torn
+    unsigned int copyLast(CPUTraceRecord *buf, unsigned int count);
+
+    // write up to count of the most recent records to a binary trace file, 0 for all
+    bool save(std::string filename, unsigned int count = 0);
+
+    // decode a binary trace file to text
+    static bool decode(std::string filename, std::ostream &out);
+};
+
+#endif // CLASS_CPUTRACE
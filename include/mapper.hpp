@@ -0,0 +1,211 @@
+#ifndef CLASS_MAPPER
+#define CLASS_MAPPER
+
+#include "memorymap.hpp"
+#include "cartridge.hpp"
+#include "c2c02.hpp"
+#include "c6502.hpp"
+
+// bank sizes used by the mappers
+#define PRG_8K 0x2000
+#define PRG_16K 0x4000
+#define PRG_32K 0x8000
+#define CHR_1K 0x0400
+#define CHR_2K 0x0800
+#define CHR_4K 0x1000
+#define CHR_8K 0x2000
+
+// cartridge board logic
+// the mapper receives CPU writes to 0x8000 - 0xffff and switches banks by pointing
+// CPU and PPU memory pages at the rom image, bank contents are never copied
+class Mapper : public MemoryHandler
+{
+protected:
+
+    Cartridge *m_Cartridge;
+    MemoryMap *m_MemCPU;
+    MemoryMap *m_MemPPU;
+    C2C02 *m_PPU;
+    C6502 *m_CPU;
+
+    const uint8_t *m_PRGROM;
+    unsigned int m_PRGROMSize;
+    const uint8_t *m_CHRROM;
+    unsigned int m_CHRROMSize;
+
+    // CHR RAM when the cartridge has no CHR ROM
+    uint8_t *m_CHRRAM;
+    unsigned int m_CHRRAMSize;
+
+    // CHR mapped to each 1KB of the pattern tables, unchanged banks keep their decoded tiles
+    const uint8_t *m_CHRPages[8];
+
+    // set while a machine state is loaded, the PPU is already the loaded one and must not
+    // draw with the banks being replaced
+    bool m_Restoring;
+
+    // map bank number of size bytes at address, negative banks count back from the last
+    void mapPRG(uint16_t address, unsigned int size, int bank);
+    void mapCHR(uint16_t address, unsigned int size, int bank);
+    void setMirroring(MIRRORING mirroring);
+
+public:
+    Mapper(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu);
+    virtual ~Mapper();
+
+    // mapper for the cartridge's mapper number, NULL if unsupported
+    static Mapper *create(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu);
+
+    // power on bank layout, maps the registers
+    virtual void reset();
+
+    virtual const char *getName() = 0;
+
+    // CPU cycle of the next mapper irq, NO_EVENT if none is due
+    virtual uint64_t getNextEventCycle() { return NO_EVENT;}
+
+    // board registers and CHR RAM, loading remaps the banks
+    virtual void saveState(StateWriter &state);
+    virtual void loadState(StateReader &state);
+
+    // loadState as part of a whole machine state, loaded after the PPU
+    void restoreState(StateReader &state);
+
+    // registers are write only
+    uint8_t memRead(uint16_t address) { return address >> 8;}
+    void memWrite(uint16_t /*address*/, uint8_t /*val*/) {}
+};
+
+// mapper 0, 16 or 32KB PRG and 8KB CHR, no registers
+class MapperNROM : public Mapper
+{
+public:
+    MapperNROM(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+        : Mapper(cartridge, cpumem, ppumem, ppu, cpu) {}
+
+    const char *getName() { return "NROM";}
+};
+
+// mapper 1
+class MapperMMC1 : public Mapper
+{
+private:
+
+    uint8_t m_Shift;
+    int m_ShiftCount;
+
+    uint8_t m_Control;
+    uint8_t m_CHRBank0;
+    uint8_t m_CHRBank1;
+    uint8_t m_PRGBank;
+
+    void updateBanks();
+
+public:
+    MapperMMC1(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+        : Mapper(cartridge, cpumem, ppumem, ppu, cpu) {}
+
+    void reset();
+    const char *getName() { return "MMC1";}
+
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    void memWrite(uint16_t address, uint8_t val);
+};
+
+// mapper 2, switchable 16KB at 0x8000, last bank fixed at 0xc000
+class MapperUxROM : public Mapper
+{
+private:
+
+    uint8_t m_Bank;
+
+public:
+    MapperUxROM(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+        : Mapper(cartridge, cpumem, ppumem, ppu, cpu) {}
+
+    void reset();
+    const char *getName() { return "UxROM";}
+
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    void memWrite(uint16_t address, uint8_t val);
+};
+
+// mapper 3, switchable 8KB CHR
+class MapperCNROM : public Mapper
+{
+private:
+
+    uint8_t m_Bank;
+
+public:
+    MapperCNROM(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+        : Mapper(cartridge, cpumem, ppumem, ppu, cpu) {}
+
+    void reset();
+    const char *getName() { return "CNROM";}
+
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    void memWrite(uint16_t address, uint8_t val);
+};
+
+// mapper 4
+class MapperMMC3 : public Mapper, public A12Listener
+{
+private:
+
+    uint8_t m_BankSelect;
+    uint8_t m_Banks[8];
+
+    // scanline irq
+    uint8_t m_IRQLatch;
+    uint8_t m_IRQCounter;
+    bool m_IRQReload;
+    bool m_IRQEnabled;
+
+    void updateBanks();
+
+public:
+    MapperMMC3(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+        : Mapper(cartridge, cpumem, ppumem, ppu, cpu) {}
+    ~MapperMMC3();
+
+    void reset();
+    const char *getName() { return "MMC3";}
+
+    // scanline counter, clocked by the PPU and predicted for the scheduler
+    void a12Rise();
+    uint64_t getNextEventCycle();
+
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    void memWrite(uint16_t address, uint8_t val);
+};
+
+// mapper 7, switchable 32KB PRG, single screen mirroring
+class MapperAxROM : public Mapper
+{
+private:
+
+    uint8_t m_Bank;
+
+public:
+    MapperAxROM(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+        : Mapper(cartridge, cpumem, ppumem, ppu, cpu) {}
+
+    void reset();
+    const char *getName() { return "AxROM";}
+
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    void memWrite(uint16_t address, uint8_t val);
+};
+
+#endif // CLASS_MAPPER
@@ -2,15 +2,78 @@
 #define CLASS_MEMORYMAP
 
 #include <iostream>
+#include <vector>
+#include <stdint.h>
+
+// memory is mapped in pages, mirroring and direct memory work on whole pages
+#define MEMPAGE_SHIFT 10
+#define MEMPAGE_SIZE (1 << MEMPAGE_SHIFT)
+#define MEMPAGE_MASK (MEMPAGE_SIZE - 1)
+
+// device that services accesses to a handled range
+class MemoryHandler
+{
+public:
+    virtual ~MemoryHandler() {}
+
+    virtual uint8_t memRead(uint16_t address) = 0;
+    virtual void memWrite(uint16_t address, uint8_t val) = 0;
+};
+
+// page table entry
+// reads and writes each go to direct host memory when set, else to their handler
+// a write with neither is dropped (read only memory)
+struct MemoryPage
+{
+    const uint8_t *read;
+    uint8_t *write;
+    MemoryHandler *readHandler;
+    MemoryHandler *writeHandler;
+};
+
+// devices sharing a page, addresses no device claims fall back to the page memory
+class MemoryRangeHandler : public MemoryHandler
+{
+private:
+
+    struct Range
+    {
+        uint16_t start;
+        uint16_t end;
+        MemoryHandler *readHandler;
+        MemoryHandler *writeHandler;
+    };
+
+    std::vector<Range> m_Ranges;
+    uint8_t *m_Mem;
+
+public:
+    MemoryRangeHandler(uint8_t *pagemem) { m_Mem = pagemem;}
+
+    void addRange(uint16_t start, uint16_t end, MemoryHandler *readhandler, MemoryHandler *writehandler);
+
+    uint8_t memRead(uint16_t address);
+    void memWrite(uint16_t address, uint8_t val);
+};
 
 class MemoryMap
 {
 protected:
 
     unsigned int m_MemSize;
+    unsigned int m_AddressMask;
+    unsigned int m_PageCount;
 
     uint8_t *m_Mem;
-    uint8_t **m_MemMap;
+    MemoryPage *m_Pages;
+
+    // per page dispatch for devices smaller than a page, NULL if unused
+    MemoryRangeHandler **m_RangeHandlers;
+
+    bool checkPageRange(const char *caller, unsigned int startaddress, unsigned int endaddress);
+    void resetPage(unsigned int page, unsigned int mempage);
+    bool mapDevice(const char *caller, unsigned int startaddress, unsigned int endaddress,
+                   MemoryHandler *readhandler, MemoryHandler *writehandler);
 
 public:
     MemoryMap(unsigned int memsize);
@@ -19,15 +82,55 @@ public:
     void clear();
     bool clear(unsigned int startaddress, unsigned int endaddress);
 
-    uint8_t **getMap() { return m_MemMap;}
     unsigned int getSize() { return m_MemSize;}
 
     bool mirror(unsigned int start1, unsigned int end1, unsigned int start2, unsigned int end2);
     bool clearMirror(unsigned int startaddress, unsigned int endaddress);
 
+    // drop writes to a page aligned range
+    bool setReadOnly(unsigned int startaddress, unsigned int endaddress);
+
+    // read a page aligned range directly from external memory, writes are dropped
+    // or go to the write handler mapped on the page
+    // the memory is referenced, not copied, and must outlive the mapping
+    bool mapROM(unsigned int startaddress, unsigned int endaddress, const uint8_t *data);
+
+    // read and write a page aligned range directly from external memory
+    bool mapRAM(unsigned int startaddress, unsigned int endaddress, uint8_t *data);
+
+    // route a range to a device, ranges need not be page aligned
+    // handled pages leave the direct path, the rest of the map is unaffected
+    bool mapHandler(unsigned int startaddress, unsigned int endaddress, MemoryHandler *handler);
+    bool mapReadHandler(unsigned int startaddress, unsigned int endaddress, MemoryHandler *handler);
+    bool mapWriteHandler(unsigned int startaddress, unsigned int endaddress, MemoryHandler *handler);
+
+    // host pointer for an address on a direct page, NULL if handled
+    uint8_t *getPointer(unsigned int address);
+
+    // backing memory of an address, ignoring how its page is mapped
+    uint8_t *getMemory(unsigned int address) { return m_Mem + (address & m_AddressMask);}
+
     bool write(unsigned int addresss, uint8_t val);
     uint8_t read(unsigned int addresss);
+
+    // unchecked bus access, addresses wrap to the size of the map
+    uint8_t busRead(uint16_t address)
+    {
+        address &= m_AddressMask;
+        const MemoryPage &page = m_Pages[address >> MEMPAGE_SHIFT];
+
+        if(page.read) return page.read[address & MEMPAGE_MASK];
+        return page.readHandler->memRead(address);
+    }
+
+    void busWrite(uint16_t address, uint8_t val)
+    {
+        address &= m_AddressMask;
+        const MemoryPage &page = m_Pages[address >> MEMPAGE_SHIFT];
+
+        if(page.write) page.write[address & MEMPAGE_MASK] = val;
+        else if(page.writeHandler) page.writeHandler->memWrite(address, val);
+    }
 };
 
 #endif // CLASS_MEMORYMAP
-
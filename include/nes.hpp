@@ -8,11 +8,33 @@
 #include "rp2a03.hpp"
 #include "c2c02.hpp"
 #include "cartridge.hpp"
+#include "mapper.hpp"
+#include "controllers.hpp"
+#include "savestate.hpp"
+#include "rewind.hpp"
 
 
 #define MEM_SIZE 65536
 #define PPUMEM_SIZE 16384
 
+// nestest automation mode starts at 0xc000 and returns through 0xc66e
+// result codes for the official and unofficial opcode tests are left at 0x02 and 0x03
+// the official opcode tests end at 0xc6bd where the first unofficial opcode is tested, a run
+// that stops before it jammed rather than passed
+// the reference log is not in the tree, it is nestest.log from the ROM's author at
+// https://www.qmtpro.com/~nes/misc/nestest.log
+#define NESTEST_START 0xc000
+#define NESTEST_OFFICIAL_END 0xc6bd
+#define NESTEST_END 0xc66e
+#define NESTEST_MAX_INSTRUCTIONS 10000
+
+// default number of instructions kept by the cpu trace
+#define CPUTRACE_DEFAULT_SIZE 65536
+
+// rewind history length and memory for its deltas
+#define REWIND_DEFAULT_SECONDS 60
+#define REWIND_DEFAULT_BYTES (4 * 1024 * 1024)
+
 class NES
 {
 private:
@@ -25,6 +47,7 @@ private:
 
     // rom cartridge
     Cartridge *m_Cartridge;
+    Mapper *m_Mapper;
 
     // 6502 CPU / APU
     RP2A03 *m_CPU;
@@ -32,14 +55,113 @@ private:
     // PPU
     C2C02 *m_PPU;
 
+    // controller ports
+    ControllerPorts *m_Controllers;
+
+    // cpu instruction trace, NULL when off
+    CPUTrace *m_Trace;
+
+    // header and component states in save state order
+    void writeState(StateWriter &state);
+
+    // per frame state history, NULL when off
+    RewindBuffer *m_Rewind;
+    unsigned int m_RewindSeconds;
+    unsigned int m_RewindBytes;
+
+    // frames emulated past the presented one, and the state restored after them
+    unsigned int m_RunAhead;
+    uint8_t *m_RunAheadState;
+
+    // rewind and run ahead buffers, sized for the loaded cartridge
+    void createStateBuffers();
+
+    // run the machine until the PPU starts the next frame
+    bool emulateFrame();
 
 public:
     NES();
     ~NES();
 
     bool loadCartridge(std::string romfile);
+    void unloadCartridge();
     void reset();
 
+    // run the machine until the PPU starts the next frame
+    // the CPU runs ahead in slices ending on the next PPU or APU event, the PPU
+    // catches up on register access or at the end of a slice, the APU on register
+    // access, when its irq is due, or when the frame's audio is drained
+    // with run ahead on, the frame buffer holds the frame that many frames later
+    // returns false if the CPU jammed
+    bool runFrame();
+
+    // emulate frames past each real frame with the current input and present the last,
+    // then restore the real frame's state, hides frames of the game's input lag, 0 is off
+    void setRunAhead(unsigned int frames);
+    unsigned int getRunAhead() { return m_RunAhead;}
+
+    // current frame, 256x240 NES color indices
+    const uint8_t *getFrameBuffer() { return m_PPU->getFrameBuffer();}
+    bool saveFrame(std::string filename) { return m_PPU->saveFrame(filename);}
+
+    // run statistics, all counted from reset
+    uint64_t getCPUCycles() { return m_CPU->getCycles();}
+    uint64_t getInstructionCount() { return m_CPU->getInstructionCount();}
+    uint64_t getFrameCount() { return m_PPU->getFrame();}
+    uint64_t getScanlineCount() { return m_PPU->getScanlineCount();}
+
+    // position of the PPU, caught up to the CPU
+    unsigned int getScanline() { m_PPU->catchUp(); return m_PPU->getScanline();}
+    unsigned int getDot() { m_PPU->catchUp(); return m_PPU->getDot();}
+
+    // CPU cycles since the current frame started
+    uint64_t getFrameCycles() { m_PPU->catchUp(); return m_CPU->getCycles() - m_PPU->getFrameStartCycle();}
+    double getCPUClockRate();
+
+    // mono 16 bit samples at AUDIO_SAMPLE_RATE, each frame run adds a frame's worth
+    // safe to call from an audio thread while frames run, returns the number read
+    unsigned int readAudio(int16_t *samples, unsigned int count);
+
+    // audio off skips sample synthesis for runs nobody listens to, the game sees no difference
+    void setAudioEnabled(bool enabled) { m_CPU->setAudioEnabled(enabled);}
+    bool isAudioEnabled() { return m_CPU->isAudioEnabled();}
+
+    // button state for controller port 0 or 1, see BUTTON
+    void setControllerState(int port, uint8_t buttons);
+
+    // snapshot of the whole machine for the loaded cartridge
+    // states go to and from caller memory, nothing is allocated
+    unsigned int getStateSize();
+
+    // returns the bytes written, 0 if there is no cartridge or the buffer is too small
+    unsigned int saveState(uint8_t *buffer, unsigned int size);
+
+    // restore a state saved with the same cartridge, the machine is unchanged on failure
+    bool loadState(const uint8_t *buffer, unsigned int size);
+
+    // record the state at the end of every frame, up to seconds back within maxbytes of deltas
+    // 0 seconds turns rewind off
+    void enableRewind(unsigned int seconds, unsigned int maxbytes = REWIND_DEFAULT_BYTES);
+
+    // go back a number of recorded frames, returns how many were rewound
+    unsigned int rewind(unsigned int frames);
+    unsigned int getRewindFrames() { return m_Rewind ? m_Rewind->getCount() : 0;}
+    unsigned int getRewindBytes() { return m_Rewind ? m_Rewind->getUsedBytes() : 0;}
+
+    // boot the loaded nestest rom in automation mode and trace it in nestest.log format
+    // the trace is compared line by line against reflog if given, reporting the first divergence,
+    // and written to tracefile if given
+    // returns true if the trace matched, the official opcode tests ran to their end and left
+    // no error code
+    bool runNestest(std::string reflog, std::string tracefile);
+
+    // keep the last records instructions in a binary trace, 0 turns tracing off
+    void enableTrace(unsigned int records);
+    bool isTracing() { return m_Trace != NULL;}
+
+    // write the last count traced instructions to a binary trace file, 0 for all
+    bool saveTrace(std::string filename, unsigned int count = 0);
+
     void debugConsole(std::string prompt);
 };
 #endif // CLASS_NES
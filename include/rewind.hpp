@@ -0,0 +1,74 @@
+#ifndef CLASS_REWIND
+#define CLASS_REWIND
+
+#include <cstdlib>
+#include <stdint.h>
+
+// rewind history of fixed size machine states
+// only the newest state is kept whole, each older one is stored as the xor of it and
+// the state after it with runs of zeros collapsed, so unchanged memory costs almost nothing
+// going back one step xors the newest delta into the current state and frees it
+class RewindBuffer
+{
+private:
+
+    unsigned int m_StateSize;
+
+    // newest whole state and the state being added
+    uint8_t *m_Current;
+    uint8_t *m_Next;
+    bool m_HasCurrent;
+
+    // encoded deltas, oldest first in a circular arena
+    uint8_t *m_Data;
+    unsigned int m_DataSize;
+    unsigned int m_WritePos;
+
+    // scratch space for one worst case delta
+    uint8_t *m_Encoded;
+    unsigned int m_EncodedSize;
+
+    struct Entry
+    {
+        unsigned int offset;
+        unsigned int size;
+    };
+    Entry *m_Entries;
+    unsigned int m_MaxEntries;
+    unsigned int m_First; // oldest entry
+    unsigned int m_Count;
+
+    Entry &getEntry(unsigned int n) { return m_Entries[(m_First + n) % m_MaxEntries];}
+    void dropOldest();
+
+    // delta coding, tokens of [zero run][literal count][literal bytes] with varint counts
+    unsigned int encode(const uint8_t *state, const uint8_t *prev);
+    void apply(const uint8_t *delta, unsigned int size, uint8_t *state);
+
+public:
+    // keep up to maxstates steps in at most databytes of encoded deltas
+    RewindBuffer(unsigned int statesize, unsigned int maxstates, unsigned int databytes);
+    ~RewindBuffer();
+
+    void clear();
+
+    // state buffer to save the next state into before push
+    uint8_t *getPushBuffer() { return m_Next;}
+
+    // the state in the push buffer becomes the newest and the one before it is delta coded
+    void push();
+
+    // step back to the state before the newest, false if there is none
+    bool pop();
+
+    // newest whole state, NULL before the first push
+    const uint8_t *getCurrent() { return m_HasCurrent ? m_Current : NULL;}
+
+    // steps that can be popped
+    unsigned int getCount() { return m_Count;}
+
+    // bytes of encoded deltas held
+    unsigned int getUsedBytes();
+};
+
+#endif // CLASS_REWIND
@@ -0,0 +1,55 @@
+#ifndef CLASS_ROMIMAGE
+#define CLASS_ROMIMAGE
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+
+// read only rom file mapped into memory
+// images are shared by every user of the same file in the process, and the
+// mapping is backed by the file's page cache so other processes share it too
+class ROMImage
+{
+private:
+
+    std::string m_FileName;
+
+    const uint8_t *m_Data;
+    unsigned int m_Size;
+
+    // true if mapped, false if read into a heap buffer as a fallback
+    bool m_Mapped;
+
+#ifdef _WIN32
+    void *m_FileHandle;
+    void *m_MappingHandle;
+#endif
+
+    unsigned int m_RefCount;
+
+    // open images by file name
+    static std::map<std::string, ROMImage*> m_Images;
+    static std::mutex m_ImagesMutex;
+
+    ROMImage(std::string filename);
+    ~ROMImage();
+
+    bool load();
+    bool mapFile();
+    bool readFile();
+
+public:
+
+    // get a shared image of the file, NULL on failure
+    static ROMImage *open(std::string filename);
+
+    // drop a reference from open, the image is unmapped when the last one goes
+    void release();
+
+    const uint8_t *getData() const { return m_Data;}
+    unsigned int getSize() const { return m_Size;}
+    bool isMapped() const { return m_Mapped;}
+};
+
+#endif // CLASS_ROMIMAGE
@@ -2,15 +2,131 @@
 #define CLASS_RP2A03
 
 #include "c6502.hpp"
+#include "apuchannels.hpp"
+#include "blipbuffer.hpp"
+#include "audioring.hpp"
 
-class RP2A03 : public C6502
+// CPU clock rates in Hz
+#define CPU_CLOCK_NTSC 1789773.0
+#define CPU_CLOCK_PAL 1662607.0
+
+// host audio rate
+#define AUDIO_SAMPLE_RATE 48000
+
+// APU registers
+#define APU_REG_START 0x4000
+#define APU_REG_END 0x4013
+#define APU_STATUS 0x4015
+#define APU_FRAME_COUNTER 0x4017
+
+class RP2A03 : public C6502, public MemoryHandler
 {
 private:
 
+    // last values written to 0x4000 - 0x4017
+    uint8_t m_APURegisters[0x18];
+
+    // the APU runs lazily, it is caught up to the CPU cycle count on register access
+    uint64_t m_APUCycles;
+
+    APUPulse m_Pulse[2];
+    APUTriangle m_Triangle;
+    APUNoise m_Noise;
+    APUDMC m_DMC;
+
+    // frame counter
+    bool m_PAL;
+    bool m_FrameFiveStep;
+    bool m_FrameIRQInhibit;
+    bool m_FrameIRQ;
+    unsigned int m_FrameCycle; // position in the frame sequence
+    unsigned int m_FrameStep; // next step of the sequence
+    const unsigned int *getFrameSteps();
+    void clockFrameSequencer();
+    void clockQuarterFrame();
+    void clockHalfFrame();
+
+    // run the channels from one timer clock or frame step to the next up to target
+    void runAPU(uint64_t target);
+
+    // with audio off only what the game can see runs, the frame sequencer and the dmc
+    void runAPUQuiet(uint64_t target);
+
+    // the dmc reads its next sample byte through the cpu bus, halting the cpu for stolen cycles
+    void fetchDMCSample(unsigned int stolen);
+    unsigned int getDMCStolenCycles();
+
+    // audio output, level changes are added to the blip buffer as steps
+    BlipBuffer m_Blip;
+    AudioRing *m_AudioRing;
+    uint64_t m_BlipStart; // APU cycle of the start of the blip frame
+    float m_Output;
+    bool m_AudioEnabled;
+
+    // nonlinear mixer, pulse levels summed and triangle/noise/dmc as 3t + 2n + d
+    float m_PulseTable[31];
+    float m_TNDTable[203];
+    float mix()
+    {
+        return m_PulseTable[m_Pulse[0].getOutput() + m_Pulse[1].getOutput()] +
+               m_TNDTable[3 * m_Triangle.getOutput() + 2 * m_Noise.getOutput() + m_DMC.getOutput()];
+    }
+    void updateOutput()
+    {
+        if(!m_AudioEnabled) return;
+
+        float output = mix();
+        if(output == m_Output) return;
+
+        m_Blip.addDelta(m_APUCycles - m_BlipStart, output - m_Output);
+        m_Output = output;
+    }
+
+    // close the blip frame at the APU cycle, its steps keep their times when the
+    // timeline is rebased and the next frame starts from here
+    void endBlipFrame();
+
 public:
-    RP2A03(uint8_t **memory, unsigned int memory_size);
+    RP2A03(MemoryMap *memory);
     ~RP2A03();
 
+    // map APU registers to CPU memory, 0x4016 is left to the controller ports
+    void mapRegisters();
+
+    // reset CPU and APU
+    bool reset();
+
+    // CPU state followed by the APU
+    void saveState(StateWriter &state);
+    void loadState(StateReader &state);
+
+    // NTSC or PAL frame counter and channel timing
+    void setRegion(bool pal);
+
+    // run the APU up to the current CPU cycle
+    void catchUpAPU();
+
+    // CPU cycle of the next frame irq or dmc sample fetch, used to schedule the catch up
+    // fetches steal cycles from the CPU, they are added to its count when the APU reaches them
+    uint64_t getNextAPUEventCycle();
+
+    // with audio off no samples are made and the pulse, triangle and noise timers hold,
+    // length counters, $4015, the frame irq and the dmc keep running
+    // the time spent off is left out of the audio
+    void setAudioEnabled(bool enabled);
+    bool isAudioEnabled() { return m_AudioEnabled;}
+
+    // catch up and move the samples of everything run so far into the audio ring
+    // does nothing with audio off
+    void endAudioFrame();
+
+    // ring the audio consumer reads from
+    AudioRing *getAudioRing() { return m_AudioRing;}
+
+    // CPU access to the APU registers
+    uint8_t memRead(uint16_t address);
+    void memWrite(uint16_t address, uint8_t val);
+
     void debugConsole(std::string prompt);
 };
 
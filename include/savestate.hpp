@@ -0,0 +1,104 @@
+#ifndef CLASS_SAVESTATE
+#define CLASS_SAVESTATE
+
+#include <cstring>
+#include <stdint.h>
+
+// save state blob, a header followed by each component's state in a fixed order
+// values are stored in host byte order, states are not portable between hosts
+#define SAVESTATE_MAGIC "NESS"
+#define SAVESTATE_VERSION 3
+
+struct SaveStateHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t size; // total bytes including the header
+    uint16_t mapper;
+    uint8_t pal;
+    uint8_t reserved;
+    uint32_t prgromsize;
+};
+
+// sequential writer into a caller buffer, nothing is allocated
+// with a NULL buffer it only counts, which is how the required size is found
+class StateWriter
+{
+private:
+
+    uint8_t *m_Data;
+    unsigned int m_Size;
+    unsigned int m_Pos;
+    bool m_Overflow;
+
+public:
+    StateWriter(uint8_t *data, unsigned int size)
+    {
+        m_Data = data;
+        m_Size = size;
+        m_Pos = 0;
+        m_Overflow = false;
+    }
+
+    void write(const void *src, unsigned int bytes)
+    {
+        if(m_Data)
+        {
+            if(m_Pos + bytes > m_Size)
+            {
+                m_Overflow = true;
+                return;
+            }
+            memcpy(m_Data + m_Pos, src, bytes);
+        }
+        m_Pos += bytes;
+    }
+
+    template<typename T> void put(const T &val) { write(&val, sizeof(T));}
+
+    unsigned int getPosition() { return m_Pos;}
+    uint8_t *getData() { return m_Data;}
+
+    // true if the buffer was too small, the state is incomplete
+    bool overflowed() { return m_Overflow;}
+};
+
+// sequential reader over a state blob
+class StateReader
+{
+private:
+
+    const uint8_t *m_Data;
+    unsigned int m_Size;
+    unsigned int m_Pos;
+    bool m_Error;
+
+public:
+    StateReader(const uint8_t *data, unsigned int size)
+    {
+        m_Data = data;
+        m_Size = size;
+        m_Pos = 0;
+        m_Error = false;
+    }
+
+    void read(void *dst, unsigned int bytes)
+    {
+        if(m_Error || m_Pos + bytes > m_Size)
+        {
+            m_Error = true;
+            return;
+        }
+        memcpy(dst, m_Data + m_Pos, bytes);
+        m_Pos += bytes;
+    }
+
+    template<typename T> void get(T &val) { read(&val, sizeof(T));}
+
+    unsigned int getPosition() { return m_Pos;}
+
+    // true if the blob ended early
+    bool failed() { return m_Error;}
+};
+
+#endif // CLASS_SAVESTATE
@@ -0,0 +1,24 @@
+#ifndef CLASS_TILEDECODER
+#define CLASS_TILEDECODER
+
+#include <stdint.h>
+
+// 2bpp tile decoding
+// a tile is 16 bytes, 8 rows of the low bitplane followed by 8 rows of the high bitplane
+// decoded pixels are palette indices 0 - 3, left to right, pixel 0 is bit 7
+//
+// uses AVX2 or SSE2 when the compiler targets them, otherwise a scalar fallback
+
+#define TILE_BYTES 16
+#define TILE_PIXELS 64
+
+// one row, 8 pixels
+void decodeTileRow(uint8_t lo, uint8_t hi, uint8_t *pixels);
+
+// whole tile, 64 pixels row by row
+void decodeTile(const uint8_t *planes, uint8_t *pixels);
+
+// name of the decoder compiled in, for debug output
+const char *getTileDecoderName();
+
+#endif // CLASS_TILEDECODER
@@ -0,0 +1,329 @@
+#include "apuchannels.hpp"
+
+const uint8_t APULengthTable[32] =
+{
+    10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+    12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+const uint16_t APUNoisePeriods[2][16] =
+{
+    {4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068},
+    {4, 8, 14, 30, 60, 88, 118, 148, 188, 236, 354, 472, 708, 944, 1890, 3778}
+};
+
+const uint16_t APUDMCRates[2][16] =
+{
+    {428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54},
+    {398, 354, 316, 298, 276, 236, 210, 198, 176, 148, 132, 118, 98, 78, 66, 50}
+};
+
+static const uint8_t DutyTable[4][8] =
+{
+    {0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 1, 1, 1, 0, 0, 0},
+    {1, 0, 0, 1, 1, 1, 1, 1}
+};
+
+////////////////////////////////////////////////////////////////
+// envelope
+
+void APUEnvelope::reset()
+{
+    m_Start = false;
+    m_Divider = 0;
+    m_Decay = 0;
+}
+
+////////////////////////////////////////////////////////////////
+// pulse
+
+void APUPulse::reset(bool onescomplement)
+{
+    m_OnesComplement = onescomplement;
+
+    m_Control = 0;
+    m_Sweep = 0;
+    m_Period = 0;
+    m_Length = 0;
+    m_Enabled = false;
+
+    m_Envelope.reset();
+    m_SweepReload = false;
+    m_SweepDivider = 0;
+    m_Step = 0;
+
+    m_Timer = 2;
+}
+
+void APUPulse::write(unsigned int reg, uint8_t val)
+{
+    switch(reg)
+    {
+    case 0:
+        m_Control = val;
+        break;
+    case 1:
+        m_Sweep = val;
+        m_SweepReload = true;
+        break;
+    case 2:
+        m_Period = (m_Period & 0x700) | val;
+        break;
+    case 3:
+        m_Period = (m_Period & 0xff) | (uint16_t(val & 0x7) << 8);
+        if(m_Enabled) m_Length = APULengthTable[val >> 3];
+        m_Step = 0;
+        m_Envelope.restart();
+        break;
+    }
+}
+
+void APUPulse::setEnabled(bool enabled)
+{
+    m_Enabled = enabled;
+    if(!enabled) m_Length = 0;
+}
+
+uint16_t APUPulse::getSweepTarget()
+{
+    int change = m_Period >> (m_Sweep & 0x7);
+
+    if(m_Sweep & 0x08)
+    {
+        int target = m_Period - change - (m_OnesComplement ? 1 : 0);
+        return target < 0 ? 0 : target;
+    }
+
+    return m_Period + change;
+}
+
+void APUPulse::clockHalf()
+{
+    if(m_Length && !(m_Control & 0x20)) m_Length--;
+
+    if(!m_SweepDivider && (m_Sweep & 0x80) && (m_Sweep & 0x7) && !isMuted()) m_Period = getSweepTarget();
+
+    if(!m_SweepDivider || m_SweepReload)
+    {
+        m_SweepDivider = (m_Sweep >> 4) & 0x7;
+        m_SweepReload = false;
+    }
+    else m_SweepDivider--;
+}
+
+uint8_t APUPulse::getOutput()
+{
+    if(!m_Length || isMuted() || !DutyTable[m_Control >> 6][m_Step]) return 0;
+    return m_Envelope.getVolume(m_Control);
+}
+
+////////////////////////////////////////////////////////////////
+// triangle
+
+void APUTriangle::reset()
+{
+    m_Control = 0;
+    m_Period = 0;
+    m_Length = 0;
+    m_Enabled = false;
+
+    m_Linear = 0;
+    m_LinearReload = false;
+    m_Step = 0;
+
+    m_Timer = 1;
+}
+
+void APUTriangle::write(unsigned int reg, uint8_t val)
+{
+    switch(reg)
+    {
+    case 0:
+        m_Control = val;
+        break;
+    case 2:
+        m_Period = (m_Period & 0x700) | val;
+        break;
+    case 3:
+        m_Period = (m_Period & 0xff) | (uint16_t(val & 0x7) << 8);
+        if(m_Enabled) m_Length = APULengthTable[val >> 3];
+        m_LinearReload = true;
+        break;
+    }
+}
+
+void APUTriangle::setEnabled(bool enabled)
+{
+    m_Enabled = enabled;
+    if(!enabled) m_Length = 0;
+}
+
+void APUTriangle::clockQuarter()
+{
+    if(m_LinearReload) m_Linear = m_Control & 0x7f;
+    else if(m_Linear) m_Linear--;
+
+    if(!(m_Control & 0x80)) m_LinearReload = false;
+}
+
+////////////////////////////////////////////////////////////////
+// noise
+
+void APUNoise::reset()
+{
+    m_Control = 0;
+    m_Mode = 0;
+    m_Length = 0;
+    m_Enabled = false;
+
+    m_Envelope.reset();
+    m_Shift = 1;
+
+    m_Timer = APUNoisePeriods[m_PAL][0];
+}
+
+void APUNoise::setRegion(bool pal)
+{
+    m_PAL = pal;
+}
+
+void APUNoise::write(unsigned int reg, uint8_t val)
+{
+    switch(reg)
+    {
+    case 0:
+        m_Control = val;
+        break;
+    case 2:
+        m_Mode = val;
+        break;
+    case 3:
+        if(m_Enabled) m_Length = APULengthTable[val >> 3];
+        m_Envelope.restart();
+        break;
+    }
+}
+
+void APUNoise::setEnabled(bool enabled)
+{
+    m_Enabled = enabled;
+    if(!enabled) m_Length = 0;
+}
+
+////////////////////////////////////////////////////////////////
+// dmc
+
+void APUDMC::reset()
+{
+    m_Control = 0;
+    m_Level = 0;
+    m_SampleAddress = 0xc000;
+    m_SampleLength = 1;
+
+    m_Address = 0xc000;
+    m_BytesRemaining = 0;
+    m_Buffer = 0;
+    m_BufferFull = false;
+
+    m_Shift = 0;
+    m_BitsRemaining = 8;
+    m_Silence = true;
+
+    m_IRQ = false;
+
+    m_Timer = APUDMCRates[m_PAL][0];
+}
+
+void APUDMC::setRegion(bool pal)
+{
+    m_PAL = pal;
+}
+
+void APUDMC::write(unsigned int reg, uint8_t val)
+{
+    switch(reg)
+    {
+    case 0:
+        m_Control = val;
+        if(!(val & 0x80)) m_IRQ = false;
+        break;
+    case 1:
+        m_Level = val & 0x7f;
+        break;
+    case 2:
+        m_SampleAddress = 0xc000 + (uint16_t(val) << 6);
+        break;
+    case 3:
+        m_SampleLength = (uint16_t(val) << 4) + 1;
+        break;
+    }
+}
+
+void APUDMC::setEnabled(bool enabled)
+{
+    if(!enabled) m_BytesRemaining = 0;
+    else if(!m_BytesRemaining) restart();
+}
+
+void APUDMC::restart()
+{
+    m_Address = m_SampleAddress;
+    m_BytesRemaining = m_SampleLength;
+}
+
+void APUDMC::loadSample(uint8_t val)
+{
+    m_Buffer = val;
+    m_BufferFull = true;
+
+    // the address wraps to 0x8000 past the end of memory
+    m_Address = (m_Address == 0xffff) ? 0x8000 : m_Address + 1;
+
+    if(--m_BytesRemaining == 0)
+    {
+        if(m_Control & 0x40) restart();
+        else if(m_Control & 0x80) m_IRQ = true;
+    }
+}
+
+void APUDMC::clockTimer()
+{
+    m_Timer = APUDMCRates[m_PAL][m_Control & 0x0f];
+
+    if(!m_Silence)
+    {
+        if(m_Shift & 1)
+        {
+            if(m_Level <= 125) m_Level += 2;
+        }
+        else if(m_Level >= 2) m_Level -= 2;
+    }
+
+    m_Shift >>= 1;
+
+    // start the next byte from the sample buffer
+    if(--m_BitsRemaining == 0)
+    {
+        m_BitsRemaining = 8;
+
+        if(m_BufferFull)
+        {
+            m_Silence = false;
+            m_Shift = m_Buffer;
+            m_BufferFull = false;
+        }
+        else m_Silence = true;
+    }
+}
+
+unsigned int APUDMC::getFetchCycles()
+{
+    if(!m_BytesRemaining) return APU_NO_TIMER;
+
+    // the next byte is read as soon as the output unit empties the buffer
+    if(!m_BufferFull) return 0;
+
+    return m_Timer + (m_BitsRemaining - 1) * APUDMCRates[m_PAL][m_Control & 0x0f];
+}
@@ -0,0 +1,67 @@
+#include "audioring.hpp"
+
+#include <cstring>
+
+AudioRing::AudioRing(unsigned int capacity)
+{
+    m_Capacity = 1;
+    while(m_Capacity < capacity) m_Capacity <<= 1;
+    m_Mask = m_Capacity - 1;
+
+    m_Samples = new int16_t[m_Capacity];
+    memset(m_Samples, 0, sizeof(int16_t) * m_Capacity);
+
+    m_Written.store(0);
+    m_Read.store(0);
+}
+
+AudioRing::~AudioRing()
+{
+    delete [] m_Samples;
+}
+
+unsigned int AudioRing::write(const int16_t *samples, unsigned int count)
+{
+    uint64_t written = m_Written.load(std::memory_order_relaxed);
+    uint64_t read = m_Read.load(std::memory_order_acquire);
+
+    unsigned int space = m_Capacity - (unsigned int)(written - read);
+    if(count > space) count = space;
+
+    // copy in up to two pieces around the end of the ring
+    unsigned int pos = written & m_Mask;
+    unsigned int first = m_Capacity - pos;
+    if(first > count) first = count;
+
+    memcpy(m_Samples + pos, samples, first * sizeof(int16_t));
+    memcpy(m_Samples, samples + first, (count - first) * sizeof(int16_t));
+
+    m_Written.store(written + count, std::memory_order_release);
+
+    return count;
+}
+
+unsigned int AudioRing::read(int16_t *samples, unsigned int count)
+{
+    uint64_t read = m_Read.load(std::memory_order_relaxed);
+    uint64_t written = m_Written.load(std::memory_order_acquire);
+
+    unsigned int available = (unsigned int)(written - read);
+    if(count > available) count = available;
+
+    unsigned int pos = read & m_Mask;
+    unsigned int first = m_Capacity - pos;
+    if(first > count) first = count;
+
+    memcpy(samples, m_Samples + pos, first * sizeof(int16_t));
+    memcpy(samples + first, m_Samples, (count - first) * sizeof(int16_t));
+
+    m_Read.store(read + count, std::memory_order_release);
+
+    return count;
+}
+
+unsigned int AudioRing::getAvailable()
+{
+    return (unsigned int)(m_Written.load(std::memory_order_acquire) - m_Read.load(std::memory_order_acquire));
+}
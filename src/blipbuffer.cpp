@@ -0,0 +1,128 @@
+#include "blipbuffer.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+BlipBuffer::BlipBuffer()
+{
+    // windowed sinc with the cutoff a little under the output nyquist
+    const double cutoff = 0.45 * 2.0;
+    const double center = BLIP_TAPS / 2 - 1;
+
+    for(int p = 0; p < BLIP_PHASES; p++)
+    {
+        double sum = 0.0;
+
+        for(int i = 0; i < BLIP_TAPS; i++)
+        {
+            double x = i - center - double(p) / BLIP_PHASES;
+            double sinc = (x == 0.0) ? cutoff : sin(M_PI * cutoff * x) / (M_PI * x);
+
+            // blackman window across the taps
+            double w = (i + 1 - double(p) / BLIP_PHASES) / (BLIP_TAPS + 1);
+            double window = 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w);
+
+            m_Kernel[p][i] = sinc * window;
+            sum += m_Kernel[p][i];
+        }
+
+        // every phase passes a full step
+        for(int i = 0; i < BLIP_TAPS; i++) m_Kernel[p][i] /= sum;
+    }
+
+    m_Factor = 0;
+    clear();
+}
+
+void BlipBuffer::setRates(double clockrate, double samplerate)
+{
+    m_Factor = uint64_t(samplerate / clockrate * 4294967296.0 + 0.5);
+    clear();
+}
+
+void BlipBuffer::clear()
+{
+    m_Offset = 0;
+    m_DeltaCount = 0;
+    m_Accumulator = 0.0f;
+    m_FilterIn = 0.0f;
+    m_FilterOut = 0.0f;
+    memset(m_Buffer, 0, sizeof(m_Buffer));
+}
+
+void BlipBuffer::flushDeltas()
+{
+    for(unsigned int n = 0; n < m_DeltaCount; n++)
+    {
+        uint64_t pos = m_Offset + m_Deltas[n].clock * m_Factor;
+        unsigned int sample = pos >> 32;
+        if(sample >= BLIP_MAX_SAMPLES) continue;
+
+        const float *kernel = m_Kernel[(pos >> (32 - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1)];
+        float *out = m_Buffer + sample;
+
+#ifdef __SSE__
+        __m128 delta = _mm_set1_ps(m_Deltas[n].delta);
+
+        for(int i = 0; i < BLIP_TAPS; i += 4)
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_load_ps(kernel + i), delta)));
+#else
+        float delta = m_Deltas[n].delta;
+
+        for(int i = 0; i < BLIP_TAPS; i++) out[i] += kernel[i] * delta;
+#endif
+    }
+
+    m_DeltaCount = 0;
+}
+
+void BlipBuffer::endFrame(unsigned int clocks)
+{
+    flushDeltas();
+
+    m_Offset += clocks * m_Factor;
+
+    // drop what does not fit rather than write past the buffer
+    if( (m_Offset >> 32) > BLIP_MAX_SAMPLES) m_Offset = uint64_t(BLIP_MAX_SAMPLES) << 32;
+}
+
+unsigned int BlipBuffer::readSamples(int16_t *out, unsigned int count)
+{
+    unsigned int available = getAvailable();
+    if(count > available) count = available;
+
+    float accumulator = m_Accumulator;
+    float filterin = m_FilterIn;
+    float filterout = m_FilterOut;
+
+    for(unsigned int i = 0; i < count; i++)
+    {
+        accumulator += m_Buffer[i];
+
+        // one pole high pass removes the dc offset of the unsigned channel levels
+        filterout = accumulator - filterin + 0.999f * filterout;
+        filterin = accumulator;
+
+        float s = filterout * 32767.0f;
+        if(s > 32767.0f) s = 32767.0f;
+        else if(s < -32768.0f) s = -32768.0f;
+        out[i] = int16_t(s);
+    }
+
+    m_Accumulator = accumulator;
+    m_FilterIn = filterin;
+    m_FilterOut = filterout;
+
+    // keep the unread part and the kernel tails past it, the rest of the buffer is already clear
+    unsigned int remaining = available - count + BLIP_TAPS;
+    memmove(m_Buffer, m_Buffer + count, remaining * sizeof(float));
+    memset(m_Buffer + remaining, 0, count * sizeof(float));
+
+    m_Offset -= uint64_t(count) << 32;
+
+    return count;
+}
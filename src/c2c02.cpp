@@ -4,24 +4,31 @@
 #include <vector>
 #include <iomanip>
 #include <fstream>
+#include <cstring>
 
-
-C2C02::C2C02(uint8_t **memory, unsigned int memory_size)
+// 2C02 color index to rgb, used for frame dumps
+static const uint8_t NES_RGB[64][3] =
+{
+    { 84, 84, 84}, {  0, 30,116}, {  8, 16,144}, { 48,  0,136}, { 68,  0,100}, { 92,  0, 48}, { 84,  4,  0}, { 60, 24,  0},
+    { 32, 42,  0}, {  8, 58,  0}, {  0, 64,  0}, {  0, 60,  0}, {  0, 50, 60}, {  0,  0,  0}, {  0,  0,  0}, {  0,  0,  0},
+    {152,150,152}, {  8, 76,196}, { 48, 50,236}, { 92, 30,228}, {136, 20,176}, {160, 20,100}, {152, 34, 32}, {120, 60,  0},
+    { 84, 90,  0}, { 40,114,  0}, {  8,124,  0}, {  0,118, 40}, {  0,102,120}, {  0,  0,  0}, {  0,  0,  0}, {  0,  0,  0},
+    {236,238,236}, { 76,154,236}, {120,124,236}, {176, 98,236}, {228, 84,236}, {236, 88,180}, {236,106,100}, {212,136, 32},
+    {160,170,  0}, {116,196,  0}, { 76,208, 32}, { 56,204,108}, { 56,180,204}, { 60, 60, 60}, {  0,  0,  0}, {  0,  0,  0},
+    {236,238,236}, {168,204,236}, {188,188,236}, {212,178,236}, {236,174,236}, {236,174,212}, {236,180,176}, {228,196,144},
+    {204,210,120}, {180,222,120}, {168,226,144}, {152,226,180}, {160,214,228}, {160,162,160}, {  0,  0,  0}, {  0,  0,  0}
+};
+
+C2C02::C2C02(MemoryMap *memory)
 {
-    m_MemSize = memory_size;
     m_Mem = memory;
+    m_MemSize = m_Mem->getSize();
 
-    // these need to be mapped with CPU memory
-    // use mapRegisters(CPU MEMORY) to map registers
-    m_PPUCTRL = NULL;
-    m_PPUMASK = NULL;
-    m_PPUSTATUS = NULL;
-    m_OAMADDR = NULL;
-    m_OAMDATA = NULL;
-    m_PPUSCROLL = NULL;
-    m_PPUADDR = NULL;
-    m_PPUDATA = NULL;
-    m_OAMDMA = NULL;
+    m_CPU = NULL;
+    m_CPUMem = NULL;
+    m_A12Listener = NULL;
+    m_Mirroring = MIRROR_HORIZONTAL;
+    setRegion(false);
 
     init();
 }
@@ -33,30 +40,724 @@ C2C02::~C2C02()
 
 bool C2C02::init()
 {
+    for(int i = 0; i < 256; i++) m_OAM[i] = 0x0;
+    for(int i = 0; i < 32; i++) m_Palette[i] = 0x0;
+    for(int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) m_FrameBuffer[i] = 0x0;
+
+    invalidateTiles(0x0000, 0x1fff);
+
+    m_PPUSTATUS = 0x0;
+    m_OAMADDR = 0x0;
+
+    reset();
+
     return true;
 }
 
 void C2C02::reset()
 {
-    *m_PPUCTRL = 0x0;
-    *m_PPUMASK = 0x0;
-    *m_PPUSTATUS = 0x0;
-    //*m_OAMADDR = 0x0;
+    m_PPUCTRL = 0x0;
+    m_PPUMASK = 0x0;
+
+    m_VRAMAddr = 0x0;
+    m_TempAddr = 0x0;
+    m_FineX = 0x0;
+    m_WriteToggle = false;
+
+    m_ReadBuffer = 0x0;
+    m_IOLatch = 0x0;
+
+    m_Clock = 0;
+    m_Scanline = 0;
+    m_Dot = 0;
+    m_Frame = 0;
+    m_ScanlineCount = 0;
+    m_FrameStartClock = 0;
+    m_RenderX = 0;
+
+    m_LineSpriteCount = 0;
+    m_LineHasSprite0 = false;
+
+    m_A12 = false;
+}
+
+void C2C02::setMirroring(MIRRORING mirroring)
+{
+    m_Mirroring = mirroring;
+
+    // 0x3000 - 0x3eff mirrors 0x2000 - 0x2eff, the palette above is internal
+    switch(mirroring)
+    {
+    case MIRROR_HORIZONTAL:
+        m_Mem->mirror(0x2000, 0x23ff, 0x2400, 0x27ff);
+        m_Mem->mirror(0x2800, 0x2bff, 0x2c00, 0x2fff);
+        m_Mem->mirror(0x2000, 0x23ff, 0x3000, 0x33ff);
+        m_Mem->mirror(0x2000, 0x23ff, 0x3400, 0x37ff);
+        m_Mem->mirror(0x2800, 0x2bff, 0x3800, 0x3bff);
+        m_Mem->mirror(0x2800, 0x2bff, 0x3c00, 0x3fff);
+        break;
+    case MIRROR_VERTICAL:
+        m_Mem->mirror(0x2000, 0x27ff, 0x2800, 0x2fff);
+        m_Mem->mirror(0x2000, 0x27ff, 0x3000, 0x37ff);
+        m_Mem->mirror(0x2000, 0x27ff, 0x3800, 0x3fff);
+        break;
+    // all four nametables show the first or second 1KB
+    case MIRROR_SINGLE_LOW:
+    case MIRROR_SINGLE_HIGH:
+        {
+            const unsigned int table = (mirroring == MIRROR_SINGLE_LOW) ? 0x2000 : 0x2400;
+
+            for(unsigned int i = 0x2000; i < 0x4000; i += 0x400)
+                if(i != table) m_Mem->mirror(table, table + 0x3ff, i, i + 0x3ff);
+        }
+        break;
+    // cartridge provides the other 2KB
+    case MIRROR_FOUR_SCREEN:
+        m_Mem->mirror(0x2000, 0x2fff, 0x3000, 0x3fff);
+        break;
+    }
+}
+
+void C2C02::saveState(StateWriter &state)
+{
+    state.put(m_PPUCTRL);
+    state.put(m_PPUMASK);
+    state.put(m_PPUSTATUS);
+    state.put(m_OAMADDR);
+    state.put(m_VRAMAddr);
+    state.put(m_TempAddr);
+    state.put(m_FineX);
+    state.put(m_WriteToggle);
+    state.put(m_ReadBuffer);
+    state.put(m_IOLatch);
+    state.write(m_OAM, sizeof(m_OAM));
+    state.write(m_Palette, sizeof(m_Palette));
+    state.put(m_Mirroring);
+
+    // 4KB covers four screen boards, the other layouts only use the first 2KB
+    state.write(m_Mem->getMemory(0x2000), 0x1000);
+
+    state.put(m_Clock);
+    state.put(m_Scanline);
+    state.put(m_Dot);
+    state.put(m_Frame);
+    state.put(m_ScanlineCount);
+    state.put(m_FrameStartClock);
+    state.put(m_A12);
+
+    // the line in progress
+    state.put(m_RenderX);
+    state.write(m_BGOpaque, sizeof(m_BGOpaque));
+    state.write(m_LineSprites, sizeof(m_LineSprites));
+    state.put(m_LineSpriteCount);
+    state.put(m_LineHasSprite0);
+}
+
+void C2C02::loadState(StateReader &state)
+{
+    MIRRORING mirroring = m_Mirroring;
+
+    state.get(m_PPUCTRL);
+    state.get(m_PPUMASK);
+    state.get(m_PPUSTATUS);
+    state.get(m_OAMADDR);
+    state.get(m_VRAMAddr);
+    state.get(m_TempAddr);
+    state.get(m_FineX);
+    state.get(m_WriteToggle);
+    state.get(m_ReadBuffer);
+    state.get(m_IOLatch);
+    state.read(m_OAM, sizeof(m_OAM));
+    state.read(m_Palette, sizeof(m_Palette));
+    state.get(mirroring);
+    state.read(m_Mem->getMemory(0x2000), 0x1000);
+
+    state.get(m_Clock);
+    state.get(m_Scanline);
+    state.get(m_Dot);
+    state.get(m_Frame);
+    state.get(m_ScanlineCount);
+    state.get(m_FrameStartClock);
+    state.get(m_A12);
+
+    state.get(m_RenderX);
+    state.read(m_BGOpaque, sizeof(m_BGOpaque));
+    state.read(m_LineSprites, sizeof(m_LineSprites));
+    state.get(m_LineSpriteCount);
+    state.get(m_LineHasSprite0);
+
+    setMirroring(mirroring);
+}
+
+void C2C02::setRegion(bool pal)
+{
+    m_PAL = pal;
+
+    m_CPUDivider = pal ? CPU_DIVIDER_PAL : CPU_DIVIDER_NTSC;
+    m_PPUDivider = pal ? PPU_DIVIDER_PAL : PPU_DIVIDER_NTSC;
+    m_ScanlinesPerFrame = pal ? SCANLINES_PAL : SCANLINES_NTSC;
+}
+
+void C2C02::catchUp()
+{
+    if(!m_CPU) return;
+
+    uint64_t target = uint64_t(m_CPU->getCycles()) * m_CPUDivider;
+    if(target <= m_Clock) return;
+
+    unsigned int dots = (target - m_Clock) / m_PPUDivider;
+
+    runDots(dots);
+}
+
+void C2C02::sync()
+{
+    catchUp();
+    renderToCurrentDot();
+}
+
+uint64_t C2C02::getNextEventCycle()
+{
+    const unsigned int framedots = DOTS_PER_SCANLINE * m_ScanlinesPerFrame;
+    const unsigned int pos = m_Scanline * DOTS_PER_SCANLINE + m_Dot;
+
+    // dots until vblank is set (dot 1 has run) or the frame wraps
+    unsigned int tovblank = (VBLANK_SCANLINE * DOTS_PER_SCANLINE + 2 + framedots - pos) % framedots;
+    unsigned int toframe = framedots - pos;
+    unsigned int dots = (tovblank && tovblank < toframe) ? tovblank : toframe;
+
+    return dotsToCycle(dots);
+}
+
+uint64_t C2C02::dotsToCycle(unsigned int dots)
+{
+    // round up to the CPU cycle the dot falls in
+    uint64_t clock = m_Clock + uint64_t(dots) * m_PPUDivider;
+    return (clock + m_CPUDivider - 1) / m_CPUDivider;
+}
+
+unsigned int C2C02::getA12RiseDot()
+{
+    if(!isRendering()) return 0;
+
+    const bool bghigh = m_PPUCTRL & PPUCTRL_BG_TABLE;
+    const bool spritehigh = (m_PPUCTRL & PPUCTRL_SPRITE_TABLE) || (m_PPUCTRL & PPUCTRL_SPRITE_SIZE);
+
+    // sprite fetches from 0x1000 after background from 0x0000
+    if(!bghigh && spritehigh) return 260;
+
+    // background prefetch for the next line from 0x1000 after sprites from 0x0000
+    if(bghigh && !spritehigh) return 324;
+
+    return 0;
+}
+
+uint64_t C2C02::getA12RiseCycle(unsigned int rises)
+{
+    const unsigned int risedot = getA12RiseDot();
+    if(!risedot || !rises) return NO_EVENT;
+
+    const unsigned int prerender = m_ScanlinesPerFrame - 1;
+
+    // walk rendered lines forward from the start of the current one
+    // the rise on the current line has happened once m_Dot passes risedot
+    unsigned int line = m_Scanline;
+    unsigned int linestart = 0;
+
+    if(m_Dot > risedot)
+    {
+        linestart = DOTS_PER_SCANLINE;
+        line = (line + 1) % m_ScanlinesPerFrame;
+    }
+
+    while(true)
+    {
+        if(line < SCREEN_HEIGHT || line == prerender)
+        {
+            if(!--rises) return dotsToCycle(linestart + risedot + 1 - m_Dot);
+        }
+
+        linestart += DOTS_PER_SCANLINE;
+        line = (line + 1) % m_ScanlinesPerFrame;
+    }
+}
+
+void C2C02::runDots(unsigned int dots)
+{
+    // dots with work, as the dot after it has run
+    // 2 = vblank flags, 257 = end of the visible scanline, 258 = horizontal scroll copy,
+    // 261 / 325 = A12 rise from sprite or background fetches, 305 = vertical scroll copy on the pre-render line
+    static const unsigned int events[] = { 2, 257, 258, 261, 305, 325, DOTS_PER_SCANLINE};
+
+    const unsigned int prerender = m_ScanlinesPerFrame - 1;
+
+    while(dots)
+    {
+        // skip ahead to the next dot that has work
+        unsigned int next = 0;
+        while(events[next] <= m_Dot) next++;
+
+        unsigned int step = events[next] - m_Dot;
+        if(step > dots) step = dots;
+
+        m_Dot += step;
+        dots -= step;
+        m_Clock += uint64_t(step) * m_PPUDivider;
+
+        switch(m_Dot)
+        {
+        case 2:
+            if(m_Scanline == VBLANK_SCANLINE)
+            {
+                m_PPUSTATUS |= PPUSTATUS_VBLANK;
+                if( (m_PPUCTRL & PPUCTRL_NMI) && m_CPU) m_CPU->triggerNMI();
+            }
+            else if(m_Scanline == prerender) m_PPUSTATUS &= ~(PPUSTATUS_VBLANK | PPUSTATUS_SPRITE0 | PPUSTATUS_OVERFLOW);
+            break;
+        case 257:
+            if(m_Scanline < SCREEN_HEIGHT)
+            {
+                renderBackground(SCREEN_WIDTH);
+                renderSprites();
+                evaluateSprites();
+            }
+            else m_LineSpriteCount = 0;
+            if(isRendering() && (m_Scanline < SCREEN_HEIGHT || m_Scanline == prerender)) incrementY();
+            break;
+        case 258:
+            if(isRendering() && (m_Scanline < SCREEN_HEIGHT || m_Scanline == prerender))
+                m_VRAMAddr = (m_VRAMAddr & ~0x041f) | (m_TempAddr & 0x041f);
+            break;
+        case 261:
+        case 325:
+            if(m_A12Listener && getA12RiseDot() == m_Dot - 1 && (m_Scanline < SCREEN_HEIGHT || m_Scanline == prerender))
+                m_A12Listener->a12Rise();
+            break;
+        case 305:
+            if(isRendering() && m_Scanline == prerender)
+                m_VRAMAddr = (m_VRAMAddr & ~0x7be0) | (m_TempAddr & 0x7be0);
+            break;
+        case DOTS_PER_SCANLINE:
+            m_Dot = 0;
+            m_RenderX = 0;
+            m_Scanline++;
+            m_ScanlineCount++;
+
+            if(m_Scanline == m_ScanlinesPerFrame)
+            {
+                m_Scanline = 0;
+                m_Frame++;
+                m_FrameStartClock = m_Clock;
+
+                // NTSC drops the first dot of odd frames while rendering
+                if(!m_PAL && (m_Frame & 0x1) && isRendering()) m_Dot = 1;
+            }
+            break;
+        }
+    }
+}
+
+void C2C02::invalidateTiles(uint16_t startaddress, uint16_t endaddress)
+{
+    if(startaddress > 0x1fff) return;
+    if(endaddress > 0x1fff) endaddress = 0x1fff;
+
+    for(unsigned int i = startaddress >> 4; i <= unsigned(endaddress >> 4); i++) m_TileValid[i] = false;
+}
+
+const uint8_t *C2C02::getTile(uint16_t address)
+{
+    const unsigned int tile = (address >> 4) & (PATTERN_TILES - 1);
+
+    if(!m_TileValid[tile])
+    {
+        uint8_t planes[TILE_BYTES];
+        for(int i = 0; i < TILE_BYTES; i++) planes[i] = m_Mem->busRead( (tile << 4) + i);
+
+        decodeTile(planes, m_TileCache[tile]);
+        m_TileValid[tile] = true;
+    }
+
+    return m_TileCache[tile];
+}
+
+void C2C02::incrementX()
+{
+    // coarse x wraps into the horizontally adjacent nametable
+    if( (m_VRAMAddr & 0x001f) == 31)
+    {
+        m_VRAMAddr &= ~0x001f;
+        m_VRAMAddr ^= 0x0400;
+    }
+    else m_VRAMAddr++;
+}
+
+void C2C02::incrementY()
+{
+    // fine y, then coarse y, wrapping at row 30 into the vertically adjacent nametable
+    if( (m_VRAMAddr & 0x7000) != 0x7000) m_VRAMAddr += 0x1000;
+    else
+    {
+        m_VRAMAddr &= ~0x7000;
+
+        unsigned int y = (m_VRAMAddr & 0x03e0) >> 5;
+
+        if(y == 29)
+        {
+            y = 0;
+            m_VRAMAddr ^= 0x0800;
+        }
+        else if(y == 31) y = 0;
+        else y++;
+
+        m_VRAMAddr = (m_VRAMAddr & ~0x03e0) | (y << 5);
+    }
+}
+
+void C2C02::renderToCurrentDot()
+{
+    // pixel x is output on dot x + 1
+    if(m_Scanline >= SCREEN_HEIGHT || m_Dot < 2 || m_Dot > SCREEN_WIDTH + 1) return;
+
+    renderBackground(m_Dot - 1);
+}
+
+void C2C02::renderBackground(unsigned int endx)
+{
+    if(m_RenderX >= endx) return;
+
+    uint8_t *out = &m_FrameBuffer[m_Scanline * SCREEN_WIDTH];
+    const uint8_t backdrop = m_Palette[0];
+    const uint8_t colormask = (m_PPUMASK & 0x1) ? 0x30 : 0x3f; // greyscale
+
+    unsigned int x = m_RenderX;
+    m_RenderX = endx;
+
+    if( !(m_PPUMASK & PPUMASK_BG) )
+    {
+        for(; x < endx; x++)
+        {
+            out[x] = backdrop & colormask;
+            m_BGOpaque[x] = false;
+        }
+        return;
+    }
+
+    const uint16_t patterntable = (m_PPUCTRL & PPUCTRL_BG_TABLE) ? 0x1000 : 0x0000;
 
+    while(x < endx)
+    {
+        // tile and attribute for the tile v points at
+        const uint16_t v = m_VRAMAddr;
+        const uint8_t tile = m_Mem->busRead(0x2000 | (v & 0x0fff));
+        const uint8_t attr = m_Mem->busRead(0x23c0 | (v & 0x0c00) | ( (v >> 4) & 0x38) | ( (v >> 2) & 0x07) );
+        const uint8_t palette = ( (attr >> ( ( (v >> 4) & 0x4) | (v & 0x2) ) ) & 0x3) << 2;
+
+        // decoded tile row at fine y
+        const uint8_t *pixels = getTile(patterntable + (tile << 4)) + ( (v >> 12) & 0x7) * 8;
+
+        // pixels from the current column to the end of the tile
+        unsigned int col = (m_FineX + x) & 0x7;
+        for(; col < 8 && x < endx; col++, x++)
+        {
+            uint8_t index = pixels[col];
+
+            // left 8 pixels can be masked
+            if(x < 8 && !(m_PPUMASK & PPUMASK_BG_LEFT)) index = 0;
+
+            out[x] = (index ? m_Palette[palette | index] : backdrop) & colormask;
+            m_BGOpaque[x] = index;
+        }
+
+        if(col == 8) incrementX();
+    }
 }
 
-void C2C02::mapRegisters(uint8_t **cpumem)
+void C2C02::mapRegisters(MemoryMap *cpumem)
 {
     std::cout << "PPU registers exposed to CPU memory." << std::endl;
-    m_PPUCTRL = cpumem[PPUCTRL];
-    m_PPUMASK = cpumem[PPUMASK];
-    m_PPUSTATUS = cpumem[PPUSTATUS];
-    m_OAMADDR = cpumem[OAMADDR];
-    m_OAMDATA = cpumem[OAMDATA];
-    m_PPUSCROLL = cpumem[PPUSCROLL];
-    m_PPUADDR = cpumem[PPUADDR];
-    m_PPUDATA = cpumem[PPUDATA];
-    m_OAMDMA = cpumem[OAMDMA];
+
+    // 0x2000 - 0x2007 mirrored every 8 bytes to 0x3fff
+    cpumem->mapHandler(0x2000, 0x3fff, this);
+    cpumem->mapWriteHandler(OAMDMA, OAMDMA, this);
+
+    m_CPUMem = cpumem;
+}
+
+void C2C02::updateCPUA12()
+{
+    // outside of rendering the address bus follows v
+    if(isRendering() && (m_Scanline < SCREEN_HEIGHT || m_Scanline == m_ScanlinesPerFrame - 1) ) return;
+
+    bool a12 = m_VRAMAddr & 0x1000;
+
+    if(a12 && !m_A12 && m_A12Listener) m_A12Listener->a12Rise();
+    m_A12 = a12;
+}
+
+uint8_t C2C02::ppuRead(uint16_t address)
+{
+    address &= 0x3fff;
+
+    if(address >= PALETTE_START)
+    {
+        // 0x3f10, 0x3f14, 0x3f18 and 0x3f1c mirror the background entries
+        uint8_t index = address & 0x1f;
+        if( (index & 0x13) == 0x10) index &= ~0x10;
+        return m_Palette[index];
+    }
+
+    return m_Mem->busRead(address);
+}
+
+void C2C02::ppuWrite(uint16_t address, uint8_t val)
+{
+    address &= 0x3fff;
+
+    if(address >= PALETTE_START)
+    {
+        uint8_t index = address & 0x1f;
+        if( (index & 0x13) == 0x10) index &= ~0x10;
+        m_Palette[index] = val & 0x3f;
+        return;
+    }
+
+    // CHR ram
+    if(address < 0x2000) m_TileValid[address >> 4] = false;
+
+    m_Mem->busWrite(address, val);
+}
+
+void C2C02::evaluateSprites()
+{
+    m_LineSpriteCount = 0;
+    m_LineHasSprite0 = false;
+
+    if(!isRendering()) return;
+
+    const unsigned int height = (m_PPUCTRL & PPUCTRL_SPRITE_SIZE) ? 16 : 8;
+
+    // oam y is one less than the first line the sprite shows on
+    for(int i = 0; i < 64; i++)
+    {
+        const uint8_t *sprite = &m_OAM[i*4];
+        unsigned int row = m_Scanline - sprite[0];
+
+        if(row >= height) continue;
+
+        if(m_LineSpriteCount == 8)
+        {
+            m_PPUSTATUS |= PPUSTATUS_OVERFLOW;
+            break;
+        }
+
+        LineSprite &ls = m_LineSprites[m_LineSpriteCount++];
+        ls.y = sprite[0];
+        ls.tile = sprite[1];
+        ls.attr = sprite[2];
+        ls.x = sprite[3];
+
+        if(i == 0) m_LineHasSprite0 = true;
+    }
+}
+
+void C2C02::renderSprites()
+{
+    if( !(m_PPUMASK & PPUMASK_SPRITES) || !m_LineSpriteCount) return;
+
+    uint8_t *out = &m_FrameBuffer[m_Scanline * SCREEN_WIDTH];
+    const uint8_t colormask = (m_PPUMASK & 0x1) ? 0x30 : 0x3f;
+    const bool tall = m_PPUCTRL & PPUCTRL_SPRITE_SIZE;
+    const unsigned int startx = (m_PPUMASK & PPUMASK_SPRITES_LEFT) ? 0 : 8;
+
+    // pixels already claimed by a lower index sprite
+    bool drawn[SCREEN_WIDTH] = {false};
+
+    for(unsigned int i = 0; i < m_LineSpriteCount; i++)
+    {
+        const LineSprite &ls = m_LineSprites[i];
+
+        // sprites were evaluated on the line above
+        unsigned int row = m_Scanline - 1 - ls.y;
+        if(ls.attr & 0x80) row = (tall ? 15 : 7) - row;
+
+        uint16_t address;
+        if(tall) address = ( (ls.tile & 0x1) << 12) | ( (ls.tile & 0xfe) << 4) | ( (row & 0x8) << 1);
+        else address = ( (m_PPUCTRL & PPUCTRL_SPRITE_TABLE) ? 0x1000 : 0x0000) | (ls.tile << 4);
+
+        const uint8_t *pixels = getTile(address) + (row & 0x7) * 8;
+        const uint8_t palette = 0x10 | ( (ls.attr & 0x3) << 2);
+        const bool behind = ls.attr & 0x20;
+        const bool flip = ls.attr & 0x40;
+
+        for(unsigned int col = 0; col < 8; col++)
+        {
+            unsigned int x = ls.x + col;
+            if(x >= SCREEN_WIDTH) break;
+            if(x < startx || drawn[x]) continue;
+
+            uint8_t index = pixels[flip ? 7 - col : col];
+            if(!index) continue;
+
+            drawn[x] = true;
+
+            // sprite 0 hit, never on the last pixel
+            if(i == 0 && m_LineHasSprite0 && m_BGOpaque[x] && x != 255) m_PPUSTATUS |= PPUSTATUS_SPRITE0;
+
+            if(!behind || !m_BGOpaque[x]) out[x] = m_Palette[palette | index] & colormask;
+        }
+    }
+}
+
+void C2C02::oamDMA(uint8_t page)
+{
+    // 1 halt cycle, 1 more when started on an odd cycle, then 256 read/write pairs
+    if(m_CPU) m_CPU->stall( (m_CPU->getCycles() & 0x1) ? 514 : 513);
+
+    const uint16_t source = page << 8;
+    const uint8_t *mem = m_CPUMem ? m_CPUMem->getPointer(source) : NULL;
+
+    // ram pages are copied in bulk, wrapping at the end of OAM
+    if(mem)
+    {
+        unsigned int first = 256 - m_OAMADDR;
+
+        memcpy(&m_OAM[m_OAMADDR], mem, first);
+        if(m_OAMADDR) memcpy(&m_OAM[0], mem + first, m_OAMADDR);
+    }
+    // handled pages go over the bus a byte at a time
+    else if(m_CPUMem)
+    {
+        for(int i = 0; i < 256; i++) m_OAM[ (m_OAMADDR + i) & 0xff] = m_CPUMem->busRead(source + i);
+    }
+}
+
+uint8_t C2C02::memRead(uint16_t address)
+{
+    catchUp();
+
+    switch(PPUCTRL + (address & 0x7))
+    {
+    // reading status clears vblank and the write toggle
+    case PPUSTATUS:
+        m_IOLatch = (m_PPUSTATUS & 0xe0) | (m_IOLatch & 0x1f);
+        m_PPUSTATUS &= ~PPUSTATUS_VBLANK;
+        m_WriteToggle = false;
+        break;
+    case OAMDATA:
+        m_IOLatch = m_OAM[m_OAMADDR];
+        break;
+    case PPUDATA:
+        {
+            uint16_t vaddr = m_VRAMAddr & 0x3fff;
+
+            // palette reads are immediate, the buffer gets the nametable byte underneath
+            if(vaddr >= PALETTE_START)
+            {
+                m_IOLatch = ppuRead(vaddr) | (m_IOLatch & 0xc0);
+                m_ReadBuffer = m_Mem->busRead(vaddr - 0x1000);
+            }
+            else
+            {
+                m_IOLatch = m_ReadBuffer;
+                m_ReadBuffer = ppuRead(vaddr);
+            }
+
+            m_VRAMAddr += (m_PPUCTRL & PPUCTRL_INCREMENT) ? 32 : 1;
+            updateCPUA12();
+        }
+        break;
+    // write only registers return the last value on the bus
+    default:
+        break;
+    }
+
+    return m_IOLatch;
+}
+
+void C2C02::memWrite(uint16_t address, uint8_t val)
+{
+    // pixels before the write use the old state
+    sync();
+
+    if(address == OAMDMA)
+    {
+        oamDMA(val);
+        return;
+    }
+
+    m_IOLatch = val;
+
+    switch(PPUCTRL + (address & 0x7))
+    {
+    case PPUCTRL:
+        // enabling nmi during vblank raises it immediately
+        if( !(m_PPUCTRL & PPUCTRL_NMI) && (val & PPUCTRL_NMI) && (m_PPUSTATUS & PPUSTATUS_VBLANK) && m_CPU) m_CPU->triggerNMI();
+        m_PPUCTRL = val;
+        if(m_A12Listener && m_CPU) m_CPU->endSlice();
+        m_TempAddr = (m_TempAddr & 0xf3ff) | ( (val & PPUCTRL_NAMETABLE) << 10);
+        break;
+    case PPUMASK:
+        m_PPUMASK = val;
+        if(m_A12Listener && m_CPU) m_CPU->endSlice();
+        break;
+    case OAMADDR:
+        m_OAMADDR = val;
+        break;
+    case OAMDATA:
+        m_OAM[m_OAMADDR++] = val;
+        break;
+    case PPUSCROLL:
+        if(!m_WriteToggle)
+        {
+            m_TempAddr = (m_TempAddr & 0xffe0) | (val >> 3);
+            m_FineX = val & 0x7;
+        }
+        else m_TempAddr = (m_TempAddr & 0x8c1f) | ( (val & 0x7) << 12) | ( (val & 0xf8) << 2);
+        m_WriteToggle = !m_WriteToggle;
+        break;
+    case PPUADDR:
+        if(!m_WriteToggle) m_TempAddr = (m_TempAddr & 0x00ff) | ( (val & 0x3f) << 8);
+        else
+        {
+            m_TempAddr = (m_TempAddr & 0xff00) | val;
+            m_VRAMAddr = m_TempAddr;
+            updateCPUA12();
+        }
+        m_WriteToggle = !m_WriteToggle;
+        break;
+    case PPUDATA:
+        ppuWrite(m_VRAMAddr, val);
+        m_VRAMAddr += (m_PPUCTRL & PPUCTRL_INCREMENT) ? 32 : 1;
+        updateCPUA12();
+        break;
+    // status is read only
+    default:
+        break;
+    }
+}
+
+bool C2C02::saveFrame(std::string filename)
+{
+    std::ofstream ofile;
+
+    ofile.open(filename.c_str(), std::ios::binary);
+
+    if(!ofile.is_open())
+    {
+        std::cout << "Error saving frame, unable to open " << filename << std::endl;
+        return false;
+    }
+
+    // binary ppm
+    ofile << "P6\n" << SCREEN_WIDTH << " " << SCREEN_HEIGHT << "\n255\n";
+
+    for(int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        ofile.write( (const char*)NES_RGB[m_FrameBuffer[i] & 0x3f], 3);
+
+    ofile.close();
+
+    return true;
 }
 
 //////////////////////////////////
@@ -65,15 +766,17 @@ void C2C02::mapRegisters(uint8_t **cpumem)
 void C2C02::show()
 {
     std::cout << "PPU Registers:" << std::endl;
-    std::cout << "PPUCTRL   = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_PPUCTRL) << std::endl;
-    std::cout << "PPUMASK   = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_PPUMASK) << std::endl;
-    std::cout << "PPUSTATUS = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_PPUSTATUS) << std::endl;
-    std::cout << "OAMADDR   = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_OAMADDR) << std::endl;
-    std::cout << "OAMDATA   = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_OAMDATA) << std::endl;
-    std::cout << "PPUSCROLL = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_PPUSCROLL) << std::endl;
-    std::cout << "PPUADDR   = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_PPUADDR) << std::endl;
-    std::cout << "PPUDATA   = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_PPUDATA) << std::endl;
-    std::cout << "OAMDMA    = " << std::hex << std::setfill('0') << std::setw(2) << int(*m_OAMDMA) << std::endl;
+    std::cout << "PPUCTRL   = " << std::hex << std::setfill('0') << std::setw(2) << int(m_PPUCTRL) << std::endl;
+    std::cout << "PPUMASK   = " << std::hex << std::setfill('0') << std::setw(2) << int(m_PPUMASK) << std::endl;
+    std::cout << "PPUSTATUS = " << std::hex << std::setfill('0') << std::setw(2) << int(m_PPUSTATUS) << std::endl;
+    std::cout << "OAMADDR   = " << std::hex << std::setfill('0') << std::setw(2) << int(m_OAMADDR) << std::endl;
+    std::cout << "VRAM Addr = " << std::hex << std::setfill('0') << std::setw(4) << int(m_VRAMAddr) << std::endl;
+    std::cout << "Temp Addr = " << std::hex << std::setfill('0') << std::setw(4) << int(m_TempAddr) << std::endl;
+    std::cout << "Fine X    = " << std::dec << int(m_FineX) << std::endl;
+    std::cout << "W Toggle  = " << m_WriteToggle << std::endl;
+    std::cout << "Frame     = " << std::dec << m_Frame << std::endl;
+    std::cout << "Scanline  = " << std::dec << m_Scanline << std::endl;
+    std::cout << "Dot       = " << std::dec << m_Dot << std::endl;
 }
 
 void C2C02::debugConsole(std::string prompt)
@@ -119,6 +822,7 @@ void C2C02::debugConsole(std::string prompt)
             std::cout << "dumpmem [file] - dump memory, optionally to file" << std::endl;
             std::cout << "loadmem <file> [offset] - load memory from file at optional offset" << std::endl;
             std::cout << "printpattern | showpattern <offset> - print pattern at offset" << std::endl;
+            std::cout << "saveframe <file> - save the frame buffer as a ppm image" << std::endl;
         }
         else if(words[0] == "show")
         {
@@ -153,7 +857,8 @@ void C2C02::debugConsole(std::string prompt)
                     if(wval <= 0xff)
                     {
                         std::cout << std::hex << std::setfill('0') << std::setw(4) << addr << " = " << wval << std::endl;
-                        *m_Mem[addr] = uint8_t(wval);
+                        m_Mem->write(addr, uint8_t(wval));
+                        invalidateTiles(addr, addr);
                     }
                     else std::cout << "Value larger than 1 byte!" << std::endl;
                 }
@@ -168,7 +873,7 @@ void C2C02::debugConsole(std::string prompt)
                 for(int i = 0; i < bcount; i++)
                 {
                     std::cout << std::hex << std::setfill('0') << std::setw(4) << addr+i << ": ";
-                    std::cout << std::setfill('0') << std::setw(2) << int(*m_Mem[addr+i]) << std::endl;
+                    std::cout << std::setfill('0') << std::setw(2) << int(m_Mem->read(addr+i)) << std::endl;
                 }
 
             }
@@ -177,8 +882,9 @@ void C2C02::debugConsole(std::string prompt)
         {
             for(unsigned int i = 0; i < m_MemSize; i++)
             {
-                *m_Mem[i] = 0x0;
+                m_Mem->write(i, 0x0);
             }
+            invalidateTiles(0x0000, 0x1fff);
         }
         else if(words[0] == "dumpmem")
         {
@@ -188,7 +894,7 @@ void C2C02::debugConsole(std::string prompt)
                 {
                     std::cout << std::hex << std::setfill('0') << std::setw(4) << i*16 << ": ";
                     for(int n = 0; n < 16; n++)
-                        std::cout << std::hex << std::setfill('0') << std::setw(2) << int(*m_Mem[i*16 + n]) << " ";
+                        std::cout << std::hex << std::setfill('0') << std::setw(2) << int(m_Mem->read(i*16 + n)) << " ";
                     std::cout << std::endl;
                 }
             }
@@ -200,7 +906,7 @@ void C2C02::debugConsole(std::string prompt)
                 // find last non zero data
                 for(int i = m_MemSize-1; i >= 0; i--)
                 {
-                    if(*m_Mem[i] != 0)
+                    if(m_Mem->read(i) != 0)
                     {
                         lastentry = i;
                         break;
@@ -214,7 +920,7 @@ void C2C02::debugConsole(std::string prompt)
                 {
 
                     // write all memory to file, stopping at last non-zero address
-                    for(unsigned int i = 0; i <= lastentry; i++) ofile.put( (unsigned char)( int(*m_Mem[i])) );
+                    for(unsigned int i = 0; i <= lastentry; i++) ofile.put( (unsigned char)( int(m_Mem->read(i))) );
                     ofile.close();
                     std::cout << "Wrote " << std::dec << lastentry + 1 << " bytes to " << words[1] << std::endl;
 
@@ -244,10 +950,12 @@ void C2C02::debugConsole(std::string prompt)
                         uint8_t data = uint8_t(ifile.get());
                         if(!ifile.eof())
                         {
-                            *m_Mem[loffset + bytes] = data;
+                            m_Mem->write(loffset + bytes, data);
                             bytes++;
                         }
                     }
+                    invalidateTiles(0x0000, 0x1fff);
+
                     std::cout << "Loaded " << std::dec << bytes << " bytes from " << words[1];
                     std::cout << " starting at 0x" << std::hex << std::setfill('0') << std::setw(4) << loffset << std::endl;
                 }
@@ -256,13 +964,22 @@ void C2C02::debugConsole(std::string prompt)
             }
             else std::cout << "Incorrect parameters : loadmem <file> [offset]" << std::endl;
         }
+        else if(words[0] == "saveframe")
+        {
+            if(words.size() == 2)
+            {
+                if(saveFrame(words[1])) std::cout << "Saved frame to " << words[1] << std::endl;
+            }
+            else std::cout << "Invalid parameters!  saveframe <file>" << std::endl;
+        }
         else if(words[0] == "printpattern" || words[0] == "showpattern")
         {
             if(words.size() == 2)
             {
                 std::stringstream patss;
                 uint16_t poffset;
-                std::vector< std::vector<char> > pat;
+                uint8_t planes[TILE_BYTES];
+                uint8_t pat[TILE_PIXELS];
 
                 if(words[1][1] == 'x') words[1].erase(0,2);
 
@@ -270,42 +987,20 @@ void C2C02::debugConsole(std::string prompt)
                 patss << std::hex << words[1];
                 patss >> poffset;
 
-                pat.resize(8);
-                for(int i = 0; i < 8; i++) pat[i].resize(8);
-
                 if( int(poffset + 15) < int(m_MemSize) )
                 {
                     std::cout << "Printing pattern ";
                     std::cout << std::hex << std::setw(4) << std::setfill('0') << int(poffset) << " - ";
-                    std::cout << std::hex << std::setw(4) << std::setfill('0') << int(poffset+15) << std::endl;
-
-                    //plane 1
-                    for(int i = poffset; i < poffset + 8; i++)
-                    {
-                        for(int k = 0; k < 8; k++)
-                        {
-                            if( (*m_Mem[i] >> (7 - k)) & 0x1) pat[i - poffset][k] = '1';
-                            else pat[i - poffset][k] = '.';
-                        }
-                    }
+                    std::cout << std::hex << std::setw(4) << std::setfill('0') << int(poffset+15);
+                    std::cout << " (" << getTileDecoderName() << ")" << std::endl;
 
-                    // plane 2
-                    for(int i = poffset + 8; i < poffset + 16; i++)
-                    {
-                        for(int k = 0; k < 8; k++)
-                        {
-                            if( (*m_Mem[i] >> (7 - k)) & 0x1)
-                            {
-                                if(pat[i - poffset - 8][k]) pat[i - poffset - 8][k] = '3';
-                                else pat[i - poffset - 8][k] = '2';
-                            }
-                        }
-                    }
+                    for(int i = 0; i < TILE_BYTES; i++) planes[i] = m_Mem->read(poffset + i);
+                    decodeTile(planes, pat);
 
                     std::cout << std::endl;
                     for(int i = 0; i < 8; i++)
                     {
-                        for(int n = 0; n < 8; n++) std::cout << pat[i][n];
+                        for(int n = 0; n < 8; n++) std::cout << (pat[i*8 + n] ? char('0' + pat[i*8 + n]) : '.');
                         std::cout << std::endl;
                     }
                     std::cout << std::endl;
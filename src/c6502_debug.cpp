@@ -47,7 +47,7 @@ void C6502::debugConsole(std::string prompt)
             std::cout << "stepshow - step and show" << std::endl;
             std::cout << "r <addr> [count] - read value at memory address and optional additional bytes" << std::endl;
             std::cout << "w <addr> <byte> - write byte to memory address" << std::endl;
-            std::cout << "reset - clear registers, stack pointer, p counter" << std::endl;
+            std::cout << "reset - reset registers, pc from the reset vector" << std::endl;
             std::cout << "clearmem - clear all memory" << std::endl;
             std::cout << "dumpmem [file] - dump memory, optionally to file" << std::endl;
             std::cout << "loadmem <file> [offset] - load memory from file at optional offset" << std::endl;
@@ -93,7 +93,7 @@ void C6502::debugConsole(std::string prompt)
                     if(wval <= 0xff)
                     {
                         std::cout << std::hex << std::setfill('0') << std::setw(4) << addr << " = " << wval << std::endl;
-                        *m_Mem[addr] = uint8_t(wval);
+                        m_Mem->write(addr, uint8_t(wval));
                     }
                     else std::cout << "Value larger than 1 byte!" << std::endl;
                 }
@@ -108,25 +108,25 @@ void C6502::debugConsole(std::string prompt)
                 for(int i = 0; i < bcount; i++)
                 {
                     std::cout << std::hex << std::setfill('0') << std::setw(4) << addr+i << ": ";
-                    std::cout << std::setfill('0') << std::setw(2) << int(*m_Mem[addr+i]) << std::endl;
+                    std::cout << std::setfill('0') << std::setw(2) << int(m_Mem->read(addr+i)) << std::endl;
                 }
 
             }
         }
         else if(words[0] == "step")
         {
-            std::cout << "Executing opcode : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
+            std::cout << "Executing opcode : " << std::hex << int(read(m_RegPC)) << std::endl;
             if(!executeNextInstruction() )
             {
-                std::cout << "Opcode undefined : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
+                std::cout << "Opcode undefined : " << std::hex << int(read(m_RegPC)) << std::endl;
             }
         }
         else if(words[0] == "stepshow")
         {
-            std::cout << "Executing opcode : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
-            if(!execute(*m_Mem[m_RegPC]))
+            std::cout << "Executing opcode : " << std::hex << int(read(m_RegPC)) << std::endl;
+            if(!execute(read(m_RegPC)))
             {
-                std::cout << "Opcode undefined : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
+                std::cout << "Opcode undefined : " << std::hex << int(read(m_RegPC)) << std::endl;
             }
             show();
         }
@@ -139,7 +139,7 @@ void C6502::debugConsole(std::string prompt)
         {
             for(unsigned int i = 0; i < m_MemSize; i++)
             {
-                *m_Mem[i] = 0x0;
+                m_Mem->write(i, 0x0);
             }
         }
         else if(words[0] == "dumpmem")
@@ -150,7 +150,7 @@ void C6502::debugConsole(std::string prompt)
                 {
                     std::cout << std::hex << std::setfill('0') << std::setw(4) << i*16 << ": ";
                     for(int n = 0; n < 16; n++)
-                        std::cout << std::hex << std::setfill('0') << std::setw(2) << int(*m_Mem[i*16 + n]) << " ";
+                        std::cout << std::hex << std::setfill('0') << std::setw(2) << int(m_Mem->read(i*16 + n)) << " ";
                     std::cout << std::endl;
                 }
             }
@@ -162,7 +162,7 @@ void C6502::debugConsole(std::string prompt)
                 // find last non zero data
                 for(int i = m_MemSize-1; i >= 0; i--)
                 {
-                    if(*m_Mem[i] != 0)
+                    if(m_Mem->read(i) != 0)
                     {
                         lastentry = i;
                         break;
@@ -176,7 +176,7 @@ void C6502::debugConsole(std::string prompt)
                 {
 
                     // write all memory to file, stopping at last non-zero address
-                    for(unsigned int i = 0; i <= lastentry; i++) ofile.put( (unsigned char)( int(*m_Mem[i])) );
+                    for(unsigned int i = 0; i <= lastentry; i++) ofile.put( (unsigned char)( int(m_Mem->read(i))) );
                     ofile.close();
                     std::cout << "Wrote " << std::dec << lastentry + 1 << " bytes to " << words[1] << std::endl;
 
@@ -206,7 +206,7 @@ void C6502::debugConsole(std::string prompt)
                         uint8_t data = uint8_t(ifile.get());
                         if(!ifile.eof())
                         {
-                            *m_Mem[loffset + bytes] = data;
+                            m_Mem->write(loffset + bytes, data);
                             bytes++;
                         }
                     }
@@ -333,3 +333,50 @@ void C6502::debugConsole(std::string prompt)
         }
     }
 }
+
+std::string C6502::getTraceLine()
+{
+    const C6502Instruction &inst = m_OpTable[read(m_RegPC)];
+    uint8_t bytes = inst.op ? inst.bytes : 1;
+    uint8_t lo = read(m_RegPC + 1);
+    uint8_t hi = read(m_RegPC + 2);
+
+    std::stringstream ss;
+    ss << std::uppercase << std::hex << std::setfill('0');
+    ss << std::setw(4) << int(m_RegPC) << "  ";
+
+    for(int i = 0; i < 3; i++)
+    {
+        if(i < bytes) ss << std::setw(2) << int(read(m_RegPC + i)) << " ";
+        else ss << "   ";
+    }
+
+    // operand, without the memory annotations nestest.log adds
+    std::stringstream op;
+    op << std::uppercase << std::hex << std::setfill('0');
+    switch(inst.amode)
+    {
+    case IMMEDIATE: op << "#$" << std::setw(2) << int(lo); break;
+    case ZERO_PAGE: op << "$" << std::setw(2) << int(lo); break;
+    case ZERO_PAGE_X: op << "$" << std::setw(2) << int(lo) << ",X"; break;
+    case ZERO_PAGE_Y: op << "$" << std::setw(2) << int(lo) << ",Y"; break;
+    case ABSOLUTE: op << "$" << std::setw(4) << int(lo | (hi << 8)); break;
+    case ABSOLUTE_X: op << "$" << std::setw(4) << int(lo | (hi << 8)) << ",X"; break;
+    case ABSOLUTE_Y: op << "$" << std::setw(4) << int(lo | (hi << 8)) << ",Y"; break;
+    case INDIRECT_X: op << "($" << std::setw(2) << int(lo) << ",X)"; break;
+    case INDIRECT_Y: op << "($" << std::setw(2) << int(lo) << "),Y"; break;
+    case INDIRECT: op << "($" << std::setw(4) << int(lo | (hi << 8)) << ")"; break;
+    case ACCUMULATOR: op << "A"; break;
+    case RELATIVE: op << "$" << std::setw(4) << int(uint16_t(m_RegPC + 2 + int8_t(lo))); break;
+    default: break;
+    }
+
+    std::string dis = std::string(" ") + inst.name + " " + op.str();
+    dis.resize(33, ' ');
+    ss << dis;
+
+    ss << "A:" << std::setw(2) << int(m_RegA) << " X:" << std::setw(2) << int(m_RegX) << " Y:" << std::setw(2) << int(m_RegY);
+    ss << " P:" << std::setw(2) << int(m_RegStat) << " SP:" << std::setw(2) << int(m_RegSP);
+
+    return ss.str();
+}
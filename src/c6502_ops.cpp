@@ -5,1922 +5,875 @@
 #include <iomanip>
 #include <fstream>
 
+// program counter and base cycles are advanced by execute() from the opcode table
+// before an operation runs, operand addresses are relative to m_InstPC
+//
+// every operation is a template on its address mode and the table below takes one
+// instantiation per legal opcode, so address decoding is resolved at compile time
+
+//////////////////////////////
+// ADDRESS MODES
+
+// immediate operand is the byte following the opcode
+template<> inline uint16_t C6502::getAddress<IMMEDIATE>()
+{
+    return m_InstPC + 1;
+}
+
+// zero page gets address of 0x00YY where YY is next mem byte
+template<> inline uint16_t C6502::getAddress<ZERO_PAGE>()
+{
+    return read(m_InstPC + 1);
+}
+
+// zero page x gets address of 0x00YY where YY is REGX + next mem byte
+template<> inline uint16_t C6502::getAddress<ZERO_PAGE_X>()
+{
+    return (m_RegX + read(m_InstPC + 1)) & 0xff;
+}
+
+// zero page y gets address ox 0x00YY where YY is REGY + next mem byte
+template<> inline uint16_t C6502::getAddress<ZERO_PAGE_Y>()
+{
+    return (m_RegY + read(m_InstPC + 1)) & 0xff;
+}
+
+// ABSOLUTE gets address from next two bytes (LSB first)
+template<> inline uint16_t C6502::getAddress<ABSOLUTE>()
+{
+    return (read(m_InstPC + 2) << 8) + read(m_InstPC + 1);
+}
+
+// ABSOLUTE X gets address from next two bytes + REGX
+template<> inline uint16_t C6502::getAddress<ABSOLUTE_X>()
+{
+    uint16_t base = (read(m_InstPC + 2) << 8) + read(m_InstPC + 1);
+    uint16_t addr = base + m_RegX;
+    m_PageCrossed = (base & 0xff00) != (addr & 0xff00);
+    return addr;
+}
+
+// ABSOLUTE Y gets address from next two bytes + REGY
+template<> inline uint16_t C6502::getAddress<ABSOLUTE_Y>()
+{
+    uint16_t base = (read(m_InstPC + 2) << 8) + read(m_InstPC + 1);
+    uint16_t addr = base + m_RegY;
+    m_PageCrossed = (base & 0xff00) != (addr & 0xff00);
+    return addr;
+}
+
+// INDIRECT X reads the pointer at zero page (operand + REGX), both bytes wrap within the zero page
+template<> inline uint16_t C6502::getAddress<INDIRECT_X>()
+{
+    uint8_t ptr = m_RegX + read(m_InstPC + 1);
+    return (read(uint8_t(ptr + 1)) << 8) + read(ptr);
+}
+
+// INDIRECT Y reads the pointer at the zero page operand and adds REGY, the pointer wraps within the zero page
+template<> inline uint16_t C6502::getAddress<INDIRECT_Y>()
+{
+    uint8_t ptr = read(m_InstPC + 1);
+    uint16_t base = (read(uint8_t(ptr + 1)) << 8) + read(ptr);
+    uint16_t addr = base + m_RegY;
+    m_PageCrossed = (base & 0xff00) != (addr & 0xff00);
+    return addr;
+}
+
+// only used for JUMP
+// the high byte of the pointer is not carried into, JMP ($xxff) reads its high byte from $xx00
+template<> inline uint16_t C6502::getAddress<INDIRECT>()
+{
+    uint16_t ptr = read(m_InstPC + 1) + (read(m_InstPC + 2) << 8);
+    uint16_t hiptr = (ptr & 0xff00) | ((ptr + 1) & 0x00ff);
+    return read(ptr) + (read(hiptr) << 8);
+}
+
+//////////////////////////////
+// SHARED ARITHMETIC
+
+// relative branch, m_RegPC already points to the next instruction
+inline void C6502::branch(bool condition)
+{
+    if(!condition) return;
+
+    int8_t offset = read(m_InstPC + 1);
+    uint16_t pc = m_RegPC + offset;
+
+    if( (m_RegPC & 0xff00) != (pc & 0xff00) ) m_Cycles += 2;
+    else m_Cycles += 1;
+
+    m_RegPC = pc;
+}
+
+inline uint8_t C6502::shiftLeft(uint8_t val)
+{
+    setFlag(FLAG_CARRY, val & 0x80);
+    val = (val << 1) & 0xff;
+    setFlag(FLAG_ZERO, val == 0x00);
+    setFlag(FLAG_SIGN, val & 0x80);
+    return val;
+}
+
+inline uint8_t C6502::shiftRight(uint8_t val)
+{
+    setFlag(FLAG_CARRY, val & 0x1);
+    val = (val >> 1) & 0xff;
+    setFlag(FLAG_ZERO, val == 0x00);
+    setFlag(FLAG_SIGN, false);
+    return val;
+}
+
+inline uint8_t C6502::rotateLeft(uint8_t val)
+{
+    uint8_t original = val;
+
+    val = ( (val << 1) & 0xff) | ( (original >> 7) & 0x1);
+    setFlag(FLAG_CARRY, (original >> 7) & 0x1 );
+    setFlag(FLAG_ZERO, val == 0x0);
+    setFlag(FLAG_SIGN, val & 0x80);
+    return val;
+}
+
+inline uint8_t C6502::rotateRight(uint8_t val)
+{
+    uint8_t original = val;
+
+    val = ( (val >> 1) & 0xff) | ( (original & 0x1 ) << 7 );
+    setFlag(FLAG_CARRY, original & 0x1);
+    setFlag(FLAG_ZERO, val == 0x0);
+    setFlag(FLAG_SIGN, val & 0x80);
+    return val;
+}
+
+// A + M + C -> A, overflow when both operands have the same sign and the result differs
+inline void C6502::addWithCarry(uint8_t val)
+{
+    unsigned int temp = m_RegA + val + (getFlag(FLAG_CARRY) ? 1 : 0);
+
+    setFlag(FLAG_CARRY, temp > 0xff);
+    setFlag(FLAG_OVERFLOW, ~(m_RegA ^ val) & (m_RegA ^ temp) & 0x80);
+    m_RegA = temp & 0xff;
+    setFlag(FLAG_ZERO, m_RegA == 0x0);
+    setFlag(FLAG_SIGN, m_RegA & 0x80);
+}
+
+// reg - m, carry flag = 0 if borrow required, 1 if not
+inline void C6502::compare(uint8_t reg, uint8_t val)
+{
+    setFlag(FLAG_ZERO, reg == val);
+    setFlag(FLAG_CARRY, reg >= val);
+    setFlag(FLAG_SIGN, (reg - val) & 0x80);
+}
+
+//////////////////////////////
+// OPERATIONS
+
 // add memory to accumulator with carry
 // A + M + C -> A, C
-void C6502::ADC(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    unsigned int temp = m_RegA + (*addr) + (getFlag(FLAG_CARRY) ? 1 : 0);
-    setFlag(FLAG_ZERO, (temp == 0x0));
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "ADC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-
-    if(getFlag(FLAG_DECIMAL_MODE))
-    {
-        if (((m_RegA & 0xf) + ( (*addr) & 0xf) + (getFlag(FLAG_CARRY) ? 1 : 0)) > 9) temp += 6;
-        setFlag(FLAG_SIGN, (temp >> 7) & 0x1);
-        setFlag(FLAG_OVERFLOW,!((m_RegA ^ (*addr) ) & 0x80) && ((m_RegA ^ temp) & 0x80));
-        if (temp > 0x99) temp += 96;
-    }
-    else
-    {
-        setFlag(FLAG_SIGN, temp & 0x80 );
-        setFlag(FLAG_OVERFLOW,!((m_RegA ^ (*addr) ) & 0x80) && ((m_RegA ^ temp) & 0x80));
-        setFlag(FLAG_CARRY, temp > 0xff);
-    }
-    m_RegA = temp&0xff;
+// the 2A03 has no decimal mode, the D flag is stored but ignored
+template<ADDRESS_MODE amode> void C6502::ADC()
+{
+    addWithCarry(read(getAddress<amode>()));
 }
 
 // AND memory with accumulator
 // A&M -> A
-void C6502::AND(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "AND error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    m_RegA = m_RegA & (*addr);
+template<ADDRESS_MODE amode> void C6502::AND()
+{
+    m_RegA = m_RegA & read(getAddress<amode>());
     setFlag(FLAG_SIGN, m_RegA & 0x80);
     setFlag(FLAG_ZERO, (m_RegA == 0x0));
 }
 
 // ASL shift left one bit (memory or accumulator)
 // M|A << 1
-void C6502::ASL(ADDRESS_MODE amode) // null = accumulator
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ACCUMULATOR:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE_X:
-            m_RegPC += 3;
-            m_Cycles += 7;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "ASL error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    setFlag(FLAG_CARRY, *addr & 0x80);
-    *addr = (*addr << 1) & 0xff;
-    setFlag(FLAG_ZERO, *addr == 0x00);
-    setFlag(FLAG_SIGN, *addr & 0x80);
+template<ADDRESS_MODE amode> void C6502::ASL()
+{
+    uint16_t addr = getAddress<amode>();
+    write(addr, shiftLeft(read(addr)));
+}
 
+template<> void C6502::ASL<ACCUMULATOR>()
+{
+    m_RegA = shiftLeft(m_RegA);
 }
 
 // BCC branch on carry clear
 // branch if c == 0
-void C6502::BCC(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BCC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(!getFlag(FLAG_CARRY))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BCC()
+{
+    branch(!getFlag(FLAG_CARRY));
 }
 
 // BCS branch on carry set
 // branch if c == 1
-void C6502::BCS(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BCS error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(getFlag(FLAG_CARRY))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BCS()
+{
+    branch(getFlag(FLAG_CARRY));
 }
 
 // BEQ branch on zero flag
 // branch if z == 1
-void C6502::BEQ(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BEQ error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(getFlag(FLAG_ZERO))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BEQ()
+{
+    branch(getFlag(FLAG_ZERO));
 }
 
 // BIT - test bits in memory against accumulator
 // A & M, M7 -> N, M6 -> V
 // if result == 0, Z = 1
-void C6502::BIT(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BIT error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    setFlag(FLAG_SIGN, (*addr) & 0x80);
-    setFlag(FLAG_OVERFLOW, (*addr) & 0x40);
-    setFlag(FLAG_ZERO, m_RegA & (*addr));
+template<ADDRESS_MODE amode> void C6502::BIT()
+{
+    uint8_t val = read(getAddress<amode>());
 
+    setFlag(FLAG_SIGN, val & 0x80);
+    setFlag(FLAG_OVERFLOW, val & 0x40);
+    setFlag(FLAG_ZERO, (m_RegA & val) == 0x0);
 }
 
 // BMI - branch on result minus
 // if n == 1 (negative), branch
-void C6502::BMI(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BMI error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(getFlag(FLAG_SIGN))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BMI()
+{
+    branch(getFlag(FLAG_SIGN));
 }
 
 // BNE - branch on result not zero
 // if z == 0 (not zero), branch
-void C6502::BNE(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BNE error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(!getFlag(FLAG_ZERO))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BNE()
+{
+    branch(!getFlag(FLAG_ZERO));
 }
 
 // BPL - branch on result not negative
 // if n == 0 (not negative), branch
-void C6502::BPL(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BPL error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(!getFlag(FLAG_SIGN))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BPL()
+{
+    branch(!getFlag(FLAG_SIGN));
 }
 
 // BRK - force break
-// ... not implemented
-void C6502::BRK(ADDRESS_MODE amode)
-{
-    std::cout << "BRK NOT IMPLEMENTED" << std::endl;
-
-    switch(amode)
-    {
-    case IMPLIED:
-        m_RegPC++;
-        m_Cycles += 7;
-        break;
-    default:
-        {
-            std::stringstream emsg;
-            emsg << "BRK error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-            printError(emsg.str());
-        }
-        return;
-        break;
-    }
+// software irq, the byte after the opcode is skipped
+template<ADDRESS_MODE amode> void C6502::BRK()
+{
+    m_RegPC++;
+    interrupt(IRQ_VECTOR, true);
 }
 
 // BVC - branch on overflow clear
 // v == 0
-void C6502::BVC(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BVC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(!getFlag(FLAG_OVERFLOW))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BVC()
+{
+    branch(!getFlag(FLAG_OVERFLOW));
 }
 
 // BVS - branch on overflow set
 // v == 1
-void C6502::BVS(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case RELATIVE:
-            m_Cycles += 2;
-            m_RegPC += 2;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "BVS error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    if(getFlag(FLAG_OVERFLOW))
-    {
-        int8_t offset = *m_Mem[ (m_RegPC-2) + 1];
-        int32_t pc = (m_RegPC-2) + offset;
-
-        if( ( (m_RegPC-2) & 0xff00) != ( pc & 0xff00) ) m_Cycles += 2;
-        else m_Cycles += 1;
-
-        m_RegPC = uint16_t(pc);
-    }
+template<ADDRESS_MODE amode> void C6502::BVS()
+{
+    branch(getFlag(FLAG_OVERFLOW));
 }
 
 // CLC - clear carry flag
 // c = 0
-void C6502::CLC(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_Cycles += 2;
-            m_RegPC += 1;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CLC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::CLC()
+{
     setFlag(FLAG_CARRY, false);
 }
 
 // CLD - clear decimal mode flag
 // d = 0
-void C6502::CLD(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_Cycles += 2;
-            m_RegPC += 1;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CLD error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::CLD()
+{
     setFlag(FLAG_DECIMAL_MODE, false);
 }
 
 // CLI - clear interrupt disable flag
 // d = 0
-void C6502::CLI(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_Cycles += 2;
-            m_RegPC += 1;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CLI error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::CLI()
+{
     setFlag(FLAG_INTERRUPT_DISABLE, false);
 }
 
 // CLV - clear overflow flag
 // v = 0
-void C6502::CLV(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_Cycles += 2;
-            m_RegPC += 1;
-        break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CLV error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::CLV()
+{
     setFlag(FLAG_OVERFLOW, false);
 }
 
 // CMP - compare memory and accumulator
 // A - M
-void C6502::CMP(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CMP error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    setFlag(FLAG_ZERO, m_RegA == *addr);
-    setFlag(FLAG_CARRY, m_RegA >= *addr); // carry flag = 0 if borrow required, 1 if not
-    setFlag(FLAG_SIGN, (m_RegA - *addr) & 0x80);
+template<ADDRESS_MODE amode> void C6502::CMP()
+{
+    compare(m_RegA, read(getAddress<amode>()));
 }
 
 // CPX - comparey register x with memory
 // register x - m
-void C6502::CPX(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CPX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    setFlag(FLAG_ZERO, m_RegX == *addr);
-    setFlag(FLAG_CARRY, m_RegX >= *addr); // carry flag = 0 if borrow required, 1 if not
-    setFlag(FLAG_SIGN, (m_RegX - *addr) & 0x80);
+template<ADDRESS_MODE amode> void C6502::CPX()
+{
+    compare(m_RegX, read(getAddress<amode>()));
 }
 
 // CPY - comparey register y with memory
 // register y - m
-void C6502::CPY(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "CPY error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    setFlag(FLAG_ZERO, m_RegY == *addr);
-    setFlag(FLAG_CARRY, m_RegY >= *addr); // carry flag = 0 if borrow required, 1 if not
-    setFlag(FLAG_SIGN, (m_RegY - *addr) & 0x80);
+template<ADDRESS_MODE amode> void C6502::CPY()
+{
+    compare(m_RegY, read(getAddress<amode>()));
 }
 
 // DEC - decrement memory by 1
 // m--
-void C6502::DEC(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE_X:
-            m_RegPC += 3;
-            m_Cycles += 7;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "DEC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = *addr - 1;
-
-    setFlag(FLAG_ZERO, *addr == 0x0);
-    setFlag(FLAG_SIGN, *addr & 0x80);
+template<ADDRESS_MODE amode> void C6502::DEC()
+{
+    uint16_t addr = getAddress<amode>();
+    uint8_t val = read(addr) - 1;
 
+    write(addr, val);
+    setFlag(FLAG_ZERO, val == 0x0);
+    setFlag(FLAG_SIGN, val & 0x80);
 }
 
 // DEX - decrement register x by 1
 // reg x --
-void C6502::DEX(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "DEX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::DEX()
+{
     m_RegX = m_RegX - 1;
-
     setFlag(FLAG_ZERO, m_RegX == 0x0);
     setFlag(FLAG_SIGN, m_RegX & 0x80);
 }
 
 // DEY - decrement register y by 1
 // reg y --
-void C6502::DEY(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "DEY error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::DEY()
+{
     m_RegY = m_RegY - 1;
-
     setFlag(FLAG_ZERO, m_RegY == 0x0);
     setFlag(FLAG_SIGN, m_RegY & 0x80);
-
 }
 
 // EOR - exclusive or memory with accumulator
 // m ^ a -> a
-void C6502::EOR(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    unsigned int temp = m_RegA + (*addr) + (getFlag(FLAG_CARRY) ? 1 : 0);
-    setFlag(FLAG_ZERO, (temp == 0x0));
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "EOR error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    m_RegA = m_RegA ^ (*addr);
-
+template<ADDRESS_MODE amode> void C6502::EOR()
+{
+    m_RegA = m_RegA ^ read(getAddress<amode>());
     setFlag(FLAG_ZERO, m_RegA == 0x0);
     setFlag(FLAG_SIGN, m_RegA & 0x80);
-
 }
 
 // INC - increment memory by 1
 // m++
-void C6502::INC(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE_X:
-            m_RegPC += 3;
-            m_Cycles += 7;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "INC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = *addr + 1;
-
-    setFlag(FLAG_ZERO, *addr == 0x0);
-    setFlag(FLAG_SIGN, *addr & 0x80);
+template<ADDRESS_MODE amode> void C6502::INC()
+{
+    uint16_t addr = getAddress<amode>();
+    uint8_t val = read(addr) + 1;
 
+    write(addr, val);
+    setFlag(FLAG_ZERO, val == 0x0);
+    setFlag(FLAG_SIGN, val & 0x80);
 }
 
 // INX - increment register x by 1
 // reg x ++
-void C6502::INX(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "INX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::INX()
+{
     m_RegX = m_RegX + 1;
-
     setFlag(FLAG_ZERO, m_RegX == 0x0);
     setFlag(FLAG_SIGN, m_RegX & 0x80);
 }
 
 // INY - increment register y by 1
 // reg y ++
-void C6502::INY(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "INY error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::INY()
+{
     m_RegY = m_RegY + 1;
-
     setFlag(FLAG_ZERO, m_RegY == 0x0);
     setFlag(FLAG_SIGN, m_RegY & 0x80);
 }
 
 // JMP - jump to new location
 // pc + 1 = PClowbyte, pc + 2 = PChighbyte
-void C6502::JMP(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case ABSOLUTE:
-            m_Cycles += 3;
-            m_RegPC = ( (*m_Mem[m_RegPC + 2]) << 8) + *m_Mem[m_RegPC+1];
-            break;
-        case INDIRECT:
-            m_Cycles += 5;
-            {
-                uint16_t lobyte = *m_Mem[m_RegPC + 1] + (*m_Mem[m_RegPC + 2] << 8);
-                m_RegPC = *m_Mem[lobyte] + (*m_Mem[lobyte+1] << 8);
-            }
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "JMP error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::JMP()
+{
+    m_RegPC = getAddress<amode>();
 }
 
 // JSR - jump and save return address to stack
 // push high byte first, and lobyte second so that it pops off lo byte first
-void C6502::JSR(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case ABSOLUTE:
-            m_Cycles += 6;
-            pushStack( (m_RegPC >> 8) & 0xff);
-            pushStack(m_RegPC & 0xff);
-            m_RegPC = ( (*m_Mem[m_RegPC + 2]) << 8) + *m_Mem[m_RegPC+1];
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "JSR error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+// the address pushed is the last byte of the JSR instruction
+template<ADDRESS_MODE amode> void C6502::JSR()
+{
+    uint16_t ret = m_RegPC - 1;
+
+    pushStack( (ret >> 8) & 0xff);
+    pushStack(ret & 0xff);
+    m_RegPC = getAddress<amode>();
 }
 
 // load accumator with memory, a = m
 // LDA
-void C6502::LDA(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "LDA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    m_RegA = *addr;
-
+template<ADDRESS_MODE amode> void C6502::LDA()
+{
+    m_RegA = read(getAddress<amode>());
     setFlag(FLAG_SIGN, m_RegA & 0x80);
     setFlag(FLAG_ZERO, m_RegA == 0x0);
 }
 
 // load register x with memory, regx = m
 // LDX
-void C6502::LDX(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_Y:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "LDX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    m_RegX = *addr;
-
+template<ADDRESS_MODE amode> void C6502::LDX()
+{
+    m_RegX = read(getAddress<amode>());
     setFlag(FLAG_SIGN, m_RegX & 0x80);
     setFlag(FLAG_ZERO, m_RegX == 0x0);
 }
 
 // load register y with memory, regy = m
 // LDY
-void C6502::LDY(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "LDY error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    m_RegY = *addr;
-
+template<ADDRESS_MODE amode> void C6502::LDY()
+{
+    m_RegY = read(getAddress<amode>());
     setFlag(FLAG_SIGN, m_RegY & 0x80);
     setFlag(FLAG_ZERO, m_RegY == 0x0);
 }
 
 // LSR - shift right one bit (memory or accumulator)
 // m | a >> 1
-void C6502::LSR(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ACCUMULATOR:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE_X:
-            m_RegPC += 3;
-            m_Cycles += 7;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "LSR error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    setFlag(FLAG_CARRY, *addr & 0x1);
-    *addr = (*addr >> 1) & 0xff;
-    setFlag(FLAG_ZERO, *addr == 0x00);
-    setFlag(FLAG_SIGN, false);
+template<ADDRESS_MODE amode> void C6502::LSR()
+{
+    uint16_t addr = getAddress<amode>();
+    write(addr, shiftRight(read(addr)));
+}
+
+template<> void C6502::LSR<ACCUMULATOR>()
+{
+    m_RegA = shiftRight(m_RegA);
 }
 
 // NOP - no operation
 // 2 cycle burn
-void C6502::NOP(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "NOP error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+template<ADDRESS_MODE amode> void C6502::NOP()
+{
+
 }
 
 // ORA - or memory with accumulator
 // a | m -> a
-void C6502::ORA(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            //if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "ORA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    m_RegA = m_RegA | (*addr);
-
+template<ADDRESS_MODE amode> void C6502::ORA()
+{
+    m_RegA = m_RegA | read(getAddress<amode>());
     setFlag(FLAG_ZERO, m_RegA == 0x0);
     setFlag(FLAG_SIGN, m_RegA & 0x80);
 }
 
 // PHA - push accumulator on stack
-void C6502::PHA(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 3;
-            pushStack(m_RegA);
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "PHA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::PHA()
+{
+    pushStack(m_RegA);
 }
 
-// PHA - push accumulator on stack
-void C6502::PHP(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 3;
-            pushStack(m_RegStat);
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "PHP error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+// PHP - push status register on stack
+// the pushed copy always has B and bit 5 set
+template<ADDRESS_MODE amode> void C6502::PHP()
+{
+    pushStack(m_RegStat | (0x1 << FLAG_SOFTWARE_INTERRUPT) | (0x1 << FLAG_NOT_USED));
 }
 
 // PLA - pull accumulator from stack
-void C6502::PLA(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 4;
-            m_RegA = popStack();
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "PLA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::PLA()
+{
+    m_RegA = popStack();
+    setFlag(FLAG_SIGN, m_RegA & 0x80);
+    setFlag(FLAG_ZERO, m_RegA == 0x0);
 }
 
 // PLP - pull status register from stack
-void C6502::PLP(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 4;
-            m_RegStat = popStack();
-            //m_RegStat = m_RegStat | (0x1 << FLAG_NOT_USED);
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "PLP error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+// B only exists on the stack, bit 5 always reads back as 1
+template<ADDRESS_MODE amode> void C6502::PLP()
+{
+    pullStatus();
 }
 
 // ROL - rotate one bit left
 // memory or accumulator
-void C6502::ROL(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    uint8_t original = *addr;
-
-    switch(amode)
-    {
-        case ACCUMULATOR:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE_X:
-            m_RegPC += 3;
-            m_Cycles += 7;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "ROL error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = ( (*addr << 1) & 0xff) | ( (original >> 7) & 0x1);
+template<ADDRESS_MODE amode> void C6502::ROL()
+{
+    uint16_t addr = getAddress<amode>();
+    write(addr, rotateLeft(read(addr)));
+}
 
-    setFlag(FLAG_CARRY, (original >> 7) & 0x1 );
-    setFlag(FLAG_ZERO, *addr == 0x0);
-    setFlag(FLAG_SIGN, *addr & 0x80);
+template<> void C6502::ROL<ACCUMULATOR>()
+{
+    m_RegA = rotateLeft(m_RegA);
 }
 
 // ROR - rotate one bit right
 // memory or accumulator
-void C6502::ROR(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    uint8_t original = *addr;
-
-    switch(amode)
-    {
-        case ACCUMULATOR:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 6;
-            break;
-        case ABSOLUTE_X:
-            m_RegPC += 3;
-            m_Cycles += 7;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "ROR error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = ( (*addr >> 1) & 0xff) | ( (original & 0x1 ) << 7 );
-
-    setFlag(FLAG_CARRY, (original & 0x1 ) << 7  );
-    setFlag(FLAG_ZERO, *addr == 0x0);
-    setFlag(FLAG_SIGN, *addr & 0x80);
+template<ADDRESS_MODE amode> void C6502::ROR()
+{
+    uint16_t addr = getAddress<amode>();
+    write(addr, rotateRight(read(addr)));
+}
+
+template<> void C6502::ROR<ACCUMULATOR>()
+{
+    m_RegA = rotateRight(m_RegA);
 }
 
 // RTI - return from interrupt
 // status from stack, pc from stack
-void C6502::RTI(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 6;
-            m_RegStat = popStack();
-            m_RegPC = popStack();
-            m_RegPC = m_RegPC + ( popStack() << 8 );
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "RTI error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+template<ADDRESS_MODE amode> void C6502::RTI()
+{
+    pullStatus();
+    m_RegPC = popStack();
+    m_RegPC = m_RegPC + ( popStack() << 8 );
 }
 
 // RTS - return from subroutine
-//  pc from stack
-void C6502::RTS(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 6;
-            m_RegPC = popStack();
-            m_RegPC = m_RegPC + ( popStack() << 8 );
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "RTS error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+//  pc from stack, +1 to step past the JSR operand
+template<ADDRESS_MODE amode> void C6502::RTS()
+{
+    m_RegPC = popStack();
+    m_RegPC = m_RegPC + ( popStack() << 8 );
+    m_RegPC++;
 }
 
 // SBC - subtract memory from accumulator with borrow
-// a - m - c -> a
-void C6502::SBC(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case IMMEDIATE:
-            m_RegPC += 2;
-            m_Cycles += 2;
-            break;
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_Y:
-            if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 5;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "SBC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    unsigned int temp = m_RegA - (*addr) - (getFlag(FLAG_CARRY) ? 1 : 0);
-
-    setFlag(FLAG_SIGN, m_RegA & 0x80);
-    setFlag(FLAG_ZERO, m_RegA == 0x0); // not valid in decimal mode
-    setFlag(FLAG_OVERFLOW, ((m_RegA ^ temp) & 0x80) && ((m_RegA ^ *addr) & 0x80) );
-
-    if(getFlag(FLAG_DECIMAL_MODE))
-    {
-        if ( ((m_RegA & 0xf) - ( getFlag(FLAG_CARRY) ? 0 : 1)) < (*addr & 0xf)) temp -= 6;
-        if (temp > 0x99) temp -= 0x60;
-    }
-    setFlag(FLAG_CARRY, temp < 0x100);
-
-    m_RegA = temp & 0xff;
-
+// a - m - (1 - c) -> a, same as adding the complement of m
+template<ADDRESS_MODE amode> void C6502::SBC()
+{
+    addWithCarry(read(getAddress<amode>()) ^ 0xff);
 }
 
 // SEC - set carry flag
-void C6502::SEC(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            setFlag(FLAG_CARRY, true);
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "SEC error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+template<ADDRESS_MODE amode> void C6502::SEC()
+{
+    setFlag(FLAG_CARRY, true);
 }
 
 // SED - set decimal mode
-void C6502::SED(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            setFlag(FLAG_DECIMAL_MODE, true);
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "SED error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+template<ADDRESS_MODE amode> void C6502::SED()
+{
+    setFlag(FLAG_DECIMAL_MODE, true);
 }
 
 // SEI - set interrupt disable flag
-void C6502::SEI(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            setFlag(FLAG_INTERRUPT_DISABLE, true);
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "SEI error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
+template<ADDRESS_MODE amode> void C6502::SEI()
+{
+    setFlag(FLAG_INTERRUPT_DISABLE, true);
 }
 
 // STA - store accumulator in memory
 // m = accumulator
-void C6502::STA(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE_X:
-            //if(m_RegX + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 5;
-            break;
-        case ABSOLUTE_Y:
-            //if(m_RegY + m_RegPC+1 > 0xff) m_Cycles++;
-            m_RegPC += 3;
-            m_Cycles += 5;
-            break;
-        case INDIRECT_X:
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        case INDIRECT_Y:
-            //if( *m_Mem[m_RegPC+1] + m_RegY > 0xff) m_Cycles++;
-            m_RegPC += 2;
-            m_Cycles += 6;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "STA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = m_RegA;
+template<ADDRESS_MODE amode> void C6502::STA()
+{
+    write(getAddress<amode>(), m_RegA);
 }
 
 // STX - store reg x in memory
 // m = reg x
-void C6502::STX(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_Y:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "STX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = m_RegX;
-
+template<ADDRESS_MODE amode> void C6502::STX()
+{
+    write(getAddress<amode>(), m_RegX);
 }
 
 // STY - store reg y in memory
 // m = reg y
-void C6502::STY(ADDRESS_MODE amode)
-{
-    uint8_t *addr = getAddress(amode);
-
-    switch(amode)
-    {
-        case ZERO_PAGE:
-            m_RegPC += 2;
-            m_Cycles += 3;
-            break;
-        case ZERO_PAGE_X:
-            m_RegPC += 2;
-            m_Cycles += 4;
-            break;
-        case ABSOLUTE:
-            m_RegPC += 3;
-            m_Cycles += 4;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "STY error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-    *addr = m_RegY;
-
+template<ADDRESS_MODE amode> void C6502::STY()
+{
+    write(getAddress<amode>(), m_RegY);
 }
 
 // TAX - transfer accumulator to reg x
 // reg x = a
-void C6502::TAX(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "TAX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::TAX()
+{
     m_RegX = m_RegA;
-
     setFlag(FLAG_SIGN, m_RegX & 0x80);
     setFlag(FLAG_ZERO, m_RegX == 0x0);
 }
 
 // TAY - transfer accumulator to reg y
 // reg y = a
-void C6502::TAY(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "TAY error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::TAY()
+{
     m_RegY = m_RegA;
-
     setFlag(FLAG_SIGN, m_RegY & 0x80);
     setFlag(FLAG_ZERO, m_RegY == 0x0);
 }
 
 // TSX- transfer stack pointer to register x
 // S -> reg x
-void C6502::TSX(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "TSX error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
-
+template<ADDRESS_MODE amode> void C6502::TSX()
+{
     m_RegX = m_RegSP;
-
     setFlag(FLAG_SIGN, m_RegX & 0x80);
     setFlag(FLAG_ZERO, m_RegX == 0x0);
 }
 
 // TXA- transfer reg x to accumulator
 // a = reg x
-void C6502::TXA(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "TXA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::TXA()
+{
     m_RegA = m_RegX;
-
     setFlag(FLAG_SIGN, m_RegA & 0x80);
     setFlag(FLAG_ZERO, m_RegA == 0x0);
 }
 
 // TXS- transfer reg x to stack pointer
 // a = reg x
-void C6502::TXS(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "TXS error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::TXS()
+{
     m_RegSP = m_RegX;
 }
 
 // TYA- transfer reg y to accumulator
 // a = reg y
-void C6502::TYA(ADDRESS_MODE amode)
-{
-    switch(amode)
-    {
-        case IMPLIED:
-            m_RegPC += 1;
-            m_Cycles += 2;
-            break;
-        default:
-            {
-                std::stringstream emsg;
-                emsg << "TYA error address mode @ PC:" << std::hex << "0x" << m_RegPC;
-                printError(emsg.str());
-            }
-            return;
-            break;
-    }
-
+template<ADDRESS_MODE amode> void C6502::TYA()
+{
     m_RegA = m_RegY;
-
     setFlag(FLAG_SIGN, m_RegA & 0x80);
     setFlag(FLAG_ZERO, m_RegA == 0x0);
 }
+
+//////////////////////////////
+// OPCODE TABLE
+
+void C6502::setOp(uint8_t opcode, C6502Operation op, const char *name, ADDRESS_MODE amode, uint8_t bytes,
+                  uint8_t cycles, bool pagePenalty)
+{
+    C6502Instruction &inst = m_OpTable[opcode];
+
+    inst.op = op;
+    inst.name = name;
+    inst.amode = amode;
+    inst.bytes = bytes;
+    inst.cycles = cycles;
+    inst.pagePenalty = pagePenalty;
+}
+
+bool C6502::buildOpTable()
+{
+    // undefined opcodes
+    for(int i = 0; i < 256; i++) setOp(i, NULL, "???", IMPLIED, 1, 0);
+
+    // ADC - Add memory to accumulator with carry
+    setOp(0x69, &C6502::ADC<IMMEDIATE>, "ADC", IMMEDIATE, 2, 2);
+    setOp(0x65, &C6502::ADC<ZERO_PAGE>, "ADC", ZERO_PAGE, 2, 3);
+    setOp(0x75, &C6502::ADC<ZERO_PAGE_X>, "ADC", ZERO_PAGE_X, 2, 4);
+    setOp(0x6d, &C6502::ADC<ABSOLUTE>, "ADC", ABSOLUTE, 3, 4);
+    setOp(0x7d, &C6502::ADC<ABSOLUTE_X>, "ADC", ABSOLUTE_X, 3, 4, true);
+    setOp(0x79, &C6502::ADC<ABSOLUTE_Y>, "ADC", ABSOLUTE_Y, 3, 4, true);
+    setOp(0x61, &C6502::ADC<INDIRECT_X>, "ADC", INDIRECT_X, 2, 6);
+    setOp(0x71, &C6502::ADC<INDIRECT_Y>, "ADC", INDIRECT_Y, 2, 5, true);
+
+    //  AND - And memory with accumulator, store in accumulator
+    setOp(0x29, &C6502::AND<IMMEDIATE>, "AND", IMMEDIATE, 2, 2);
+    setOp(0x25, &C6502::AND<ZERO_PAGE>, "AND", ZERO_PAGE, 2, 3);
+    setOp(0x35, &C6502::AND<ZERO_PAGE_X>, "AND", ZERO_PAGE_X, 2, 4);
+    setOp(0x2d, &C6502::AND<ABSOLUTE>, "AND", ABSOLUTE, 3, 4);
+    setOp(0x3d, &C6502::AND<ABSOLUTE_X>, "AND", ABSOLUTE_X, 3, 4, true);
+    setOp(0x39, &C6502::AND<ABSOLUTE_Y>, "AND", ABSOLUTE_Y, 3, 4, true);
+    setOp(0x21, &C6502::AND<INDIRECT_X>, "AND", INDIRECT_X, 2, 6);
+    setOp(0x31, &C6502::AND<INDIRECT_Y>, "AND", INDIRECT_Y, 2, 5, true);
+
+    //  ASL  - Shift left one bit (memory or accumulator)
+    setOp(0x0a, &C6502::ASL<ACCUMULATOR>, "ASL", ACCUMULATOR, 1, 2);
+    setOp(0x06, &C6502::ASL<ZERO_PAGE>, "ASL", ZERO_PAGE, 2, 5);
+    setOp(0x16, &C6502::ASL<ZERO_PAGE_X>, "ASL", ZERO_PAGE_X, 2, 6);
+    setOp(0x0e, &C6502::ASL<ABSOLUTE>, "ASL", ABSOLUTE, 3, 6);
+    setOp(0x1e, &C6502::ASL<ABSOLUTE_X>, "ASL", ABSOLUTE_X, 3, 7);
+
+    // branches, +1 cycle if taken, +2 if taken across a page
+    setOp(0x90, &C6502::BCC<RELATIVE>, "BCC", RELATIVE, 2, 2);
+    setOp(0xb0, &C6502::BCS<RELATIVE>, "BCS", RELATIVE, 2, 2);
+    setOp(0xf0, &C6502::BEQ<RELATIVE>, "BEQ", RELATIVE, 2, 2);
+    setOp(0x30, &C6502::BMI<RELATIVE>, "BMI", RELATIVE, 2, 2);
+    setOp(0xd0, &C6502::BNE<RELATIVE>, "BNE", RELATIVE, 2, 2);
+    setOp(0x10, &C6502::BPL<RELATIVE>, "BPL", RELATIVE, 2, 2);
+    setOp(0x50, &C6502::BVC<RELATIVE>, "BVC", RELATIVE, 2, 2);
+    setOp(0x70, &C6502::BVS<RELATIVE>, "BVS", RELATIVE, 2, 2);
+
+    // BIT - test bits in memory with accumulator
+    setOp(0x24, &C6502::BIT<ZERO_PAGE>, "BIT", ZERO_PAGE, 2, 3);
+    setOp(0x2c, &C6502::BIT<ABSOLUTE>, "BIT", ABSOLUTE, 3, 4);
+
+    // BRK - force break
+    setOp(0x00, &C6502::BRK<IMPLIED>, "BRK", IMPLIED, 1, 7);
+
+    // flag clear
+    setOp(0x18, &C6502::CLC<IMPLIED>, "CLC", IMPLIED, 1, 2);
+    setOp(0xd8, &C6502::CLD<IMPLIED>, "CLD", IMPLIED, 1, 2);
+    setOp(0x58, &C6502::CLI<IMPLIED>, "CLI", IMPLIED, 1, 2);
+    setOp(0xb8, &C6502::CLV<IMPLIED>, "CLV", IMPLIED, 1, 2);
+
+    // CMP - compare memory and accumulator, a - m
+    setOp(0xc9, &C6502::CMP<IMMEDIATE>, "CMP", IMMEDIATE, 2, 2);
+    setOp(0xc5, &C6502::CMP<ZERO_PAGE>, "CMP", ZERO_PAGE, 2, 3);
+    setOp(0xd5, &C6502::CMP<ZERO_PAGE_X>, "CMP", ZERO_PAGE_X, 2, 4);
+    setOp(0xcd, &C6502::CMP<ABSOLUTE>, "CMP", ABSOLUTE, 3, 4);
+    setOp(0xdd, &C6502::CMP<ABSOLUTE_X>, "CMP", ABSOLUTE_X, 3, 4, true);
+    setOp(0xd9, &C6502::CMP<ABSOLUTE_Y>, "CMP", ABSOLUTE_Y, 3, 4, true);
+    setOp(0xc1, &C6502::CMP<INDIRECT_X>, "CMP", INDIRECT_X, 2, 6);
+    setOp(0xd1, &C6502::CMP<INDIRECT_Y>, "CMP", INDIRECT_Y, 2, 5, true);
+
+    // CPX - compare memory and register x, reg x - m
+    setOp(0xe0, &C6502::CPX<IMMEDIATE>, "CPX", IMMEDIATE, 2, 2);
+    setOp(0xe4, &C6502::CPX<ZERO_PAGE>, "CPX", ZERO_PAGE, 2, 3);
+    setOp(0xec, &C6502::CPX<ABSOLUTE>, "CPX", ABSOLUTE, 3, 4);
+
+    // CPY - compare memory and register y, reg y - m
+    setOp(0xc0, &C6502::CPY<IMMEDIATE>, "CPY", IMMEDIATE, 2, 2);
+    setOp(0xc4, &C6502::CPY<ZERO_PAGE>, "CPY", ZERO_PAGE, 2, 3);
+    setOp(0xcc, &C6502::CPY<ABSOLUTE>, "CPY", ABSOLUTE, 3, 4);
+
+    // DEC - decrement memory by 1
+    setOp(0xc6, &C6502::DEC<ZERO_PAGE>, "DEC", ZERO_PAGE, 2, 5);
+    setOp(0xd6, &C6502::DEC<ZERO_PAGE_X>, "DEC", ZERO_PAGE_X, 2, 6);
+    setOp(0xce, &C6502::DEC<ABSOLUTE>, "DEC", ABSOLUTE, 3, 6);
+    setOp(0xde, &C6502::DEC<ABSOLUTE_X>, "DEC", ABSOLUTE_X, 3, 7);
+
+    // DEX / DEY - decrement register by 1
+    setOp(0xca, &C6502::DEX<IMPLIED>, "DEX", IMPLIED, 1, 2);
+    setOp(0x88, &C6502::DEY<IMPLIED>, "DEY", IMPLIED, 1, 2);
+
+    // EOR - exclusive or memory with accumulator, a ^ m -> a
+    setOp(0x49, &C6502::EOR<IMMEDIATE>, "EOR", IMMEDIATE, 2, 2);
+    setOp(0x45, &C6502::EOR<ZERO_PAGE>, "EOR", ZERO_PAGE, 2, 3);
+    setOp(0x55, &C6502::EOR<ZERO_PAGE_X>, "EOR", ZERO_PAGE_X, 2, 4);
+    setOp(0x4d, &C6502::EOR<ABSOLUTE>, "EOR", ABSOLUTE, 3, 4);
+    setOp(0x5d, &C6502::EOR<ABSOLUTE_X>, "EOR", ABSOLUTE_X, 3, 4, true);
+    setOp(0x59, &C6502::EOR<ABSOLUTE_Y>, "EOR", ABSOLUTE_Y, 3, 4, true);
+    setOp(0x41, &C6502::EOR<INDIRECT_X>, "EOR", INDIRECT_X, 2, 6);
+    setOp(0x51, &C6502::EOR<INDIRECT_Y>, "EOR", INDIRECT_Y, 2, 5, true);
+
+    // INC - increment memory by 1
+    setOp(0xe6, &C6502::INC<ZERO_PAGE>, "INC", ZERO_PAGE, 2, 5);
+    setOp(0xf6, &C6502::INC<ZERO_PAGE_X>, "INC", ZERO_PAGE_X, 2, 6);
+    setOp(0xee, &C6502::INC<ABSOLUTE>, "INC", ABSOLUTE, 3, 6);
+    setOp(0xfe, &C6502::INC<ABSOLUTE_X>, "INC", ABSOLUTE_X, 3, 7);
+
+    // INX / INY - increment register by 1
+    setOp(0xe8, &C6502::INX<IMPLIED>, "INX", IMPLIED, 1, 2);
+    setOp(0xc8, &C6502::INY<IMPLIED>, "INY", IMPLIED, 1, 2);
+
+    // JMP - jump to new location
+    setOp(0x4c, &C6502::JMP<ABSOLUTE>, "JMP", ABSOLUTE, 3, 3);
+    setOp(0x6c, &C6502::JMP<INDIRECT>, "JMP", INDIRECT, 3, 5);
+
+    // JSR - jump and save return address on stack
+    setOp(0x20, &C6502::JSR<ABSOLUTE>, "JSR", ABSOLUTE, 3, 6);
+
+    // LDA - Load accumulator with memory
+    setOp(0xa9, &C6502::LDA<IMMEDIATE>, "LDA", IMMEDIATE, 2, 2);
+    setOp(0xa5, &C6502::LDA<ZERO_PAGE>, "LDA", ZERO_PAGE, 2, 3);
+    setOp(0xb5, &C6502::LDA<ZERO_PAGE_X>, "LDA", ZERO_PAGE_X, 2, 4);
+    setOp(0xad, &C6502::LDA<ABSOLUTE>, "LDA", ABSOLUTE, 3, 4);
+    setOp(0xbd, &C6502::LDA<ABSOLUTE_X>, "LDA", ABSOLUTE_X, 3, 4, true);
+    setOp(0xb9, &C6502::LDA<ABSOLUTE_Y>, "LDA", ABSOLUTE_Y, 3, 4, true);
+    setOp(0xa1, &C6502::LDA<INDIRECT_X>, "LDA", INDIRECT_X, 2, 6);
+    setOp(0xb1, &C6502::LDA<INDIRECT_Y>, "LDA", INDIRECT_Y, 2, 5, true);
+
+    // LDX - Load register x with memory
+    setOp(0xa2, &C6502::LDX<IMMEDIATE>, "LDX", IMMEDIATE, 2, 2);
+    setOp(0xa6, &C6502::LDX<ZERO_PAGE>, "LDX", ZERO_PAGE, 2, 3);
+    setOp(0xb6, &C6502::LDX<ZERO_PAGE_Y>, "LDX", ZERO_PAGE_Y, 2, 4);
+    setOp(0xae, &C6502::LDX<ABSOLUTE>, "LDX", ABSOLUTE, 3, 4);
+    setOp(0xbe, &C6502::LDX<ABSOLUTE_Y>, "LDX", ABSOLUTE_Y, 3, 4, true);
+
+    // LDY - Load register y with memory
+    setOp(0xa0, &C6502::LDY<IMMEDIATE>, "LDY", IMMEDIATE, 2, 2);
+    setOp(0xa4, &C6502::LDY<ZERO_PAGE>, "LDY", ZERO_PAGE, 2, 3);
+    setOp(0xb4, &C6502::LDY<ZERO_PAGE_X>, "LDY", ZERO_PAGE_X, 2, 4);
+    setOp(0xac, &C6502::LDY<ABSOLUTE>, "LDY", ABSOLUTE, 3, 4);
+    setOp(0xbc, &C6502::LDY<ABSOLUTE_X>, "LDY", ABSOLUTE_X, 3, 4, true);
+
+    // LSR - Shift right one bit (memory or accumulator)
+    setOp(0x4a, &C6502::LSR<ACCUMULATOR>, "LSR", ACCUMULATOR, 1, 2);
+    setOp(0x46, &C6502::LSR<ZERO_PAGE>, "LSR", ZERO_PAGE, 2, 5);
+    setOp(0x56, &C6502::LSR<ZERO_PAGE_X>, "LSR", ZERO_PAGE_X, 2, 6);
+    setOp(0x4e, &C6502::LSR<ABSOLUTE>, "LSR", ABSOLUTE, 3, 6);
+    setOp(0x5e, &C6502::LSR<ABSOLUTE_X>, "LSR", ABSOLUTE_X, 3, 7);
+
+    // NOP - no operation
+    setOp(0xea, &C6502::NOP<IMPLIED>, "NOP", IMPLIED, 1, 2);
+
+    // ORA - or memory with accumulator, a | m -> a
+    setOp(0x09, &C6502::ORA<IMMEDIATE>, "ORA", IMMEDIATE, 2, 2);
+    setOp(0x05, &C6502::ORA<ZERO_PAGE>, "ORA", ZERO_PAGE, 2, 3);
+    setOp(0x15, &C6502::ORA<ZERO_PAGE_X>, "ORA", ZERO_PAGE_X, 2, 4);
+    setOp(0x0d, &C6502::ORA<ABSOLUTE>, "ORA", ABSOLUTE, 3, 4);
+    setOp(0x1d, &C6502::ORA<ABSOLUTE_X>, "ORA", ABSOLUTE_X, 3, 4, true);
+    setOp(0x19, &C6502::ORA<ABSOLUTE_Y>, "ORA", ABSOLUTE_Y, 3, 4, true);
+    setOp(0x01, &C6502::ORA<INDIRECT_X>, "ORA", INDIRECT_X, 2, 6);
+    setOp(0x11, &C6502::ORA<INDIRECT_Y>, "ORA", INDIRECT_Y, 2, 5, true);
+
+    // stack push / pull
+    setOp(0x48, &C6502::PHA<IMPLIED>, "PHA", IMPLIED, 1, 3);
+    setOp(0x08, &C6502::PHP<IMPLIED>, "PHP", IMPLIED, 1, 3);
+    setOp(0x68, &C6502::PLA<IMPLIED>, "PLA", IMPLIED, 1, 4);
+    setOp(0x28, &C6502::PLP<IMPLIED>, "PLP", IMPLIED, 1, 4);
+
+    // ROL - rotate one bit left (memory or accumulator)
+    setOp(0x2a, &C6502::ROL<ACCUMULATOR>, "ROL", ACCUMULATOR, 1, 2);
+    setOp(0x26, &C6502::ROL<ZERO_PAGE>, "ROL", ZERO_PAGE, 2, 5);
+    setOp(0x36, &C6502::ROL<ZERO_PAGE_X>, "ROL", ZERO_PAGE_X, 2, 6);
+    setOp(0x2e, &C6502::ROL<ABSOLUTE>, "ROL", ABSOLUTE, 3, 6);
+    setOp(0x3e, &C6502::ROL<ABSOLUTE_X>, "ROL", ABSOLUTE_X, 3, 7);
+
+    // ROR - rotate one bit right (memory or accumulator)
+    setOp(0x6a, &C6502::ROR<ACCUMULATOR>, "ROR", ACCUMULATOR, 1, 2);
+    setOp(0x66, &C6502::ROR<ZERO_PAGE>, "ROR", ZERO_PAGE, 2, 5);
+    setOp(0x76, &C6502::ROR<ZERO_PAGE_X>, "ROR", ZERO_PAGE_X, 2, 6);
+    setOp(0x6e, &C6502::ROR<ABSOLUTE>, "ROR", ABSOLUTE, 3, 6);
+    setOp(0x7e, &C6502::ROR<ABSOLUTE_X>, "ROR", ABSOLUTE_X, 3, 7);
+
+    // RTI / RTS - return from interrupt / subroutine
+    setOp(0x40, &C6502::RTI<IMPLIED>, "RTI", IMPLIED, 1, 6);
+    setOp(0x60, &C6502::RTS<IMPLIED>, "RTS", IMPLIED, 1, 6);
+
+    // SBC - subtract memory from accumulator with borrow, a - m - c -> a
+    setOp(0xe9, &C6502::SBC<IMMEDIATE>, "SBC", IMMEDIATE, 2, 2);
+    setOp(0xe5, &C6502::SBC<ZERO_PAGE>, "SBC", ZERO_PAGE, 2, 3);
+    setOp(0xf5, &C6502::SBC<ZERO_PAGE_X>, "SBC", ZERO_PAGE_X, 2, 4);
+    setOp(0xed, &C6502::SBC<ABSOLUTE>, "SBC", ABSOLUTE, 3, 4);
+    setOp(0xfd, &C6502::SBC<ABSOLUTE_X>, "SBC", ABSOLUTE_X, 3, 4, true);
+    setOp(0xf9, &C6502::SBC<ABSOLUTE_Y>, "SBC", ABSOLUTE_Y, 3, 4, true);
+    setOp(0xe1, &C6502::SBC<INDIRECT_X>, "SBC", INDIRECT_X, 2, 6);
+    setOp(0xf1, &C6502::SBC<INDIRECT_Y>, "SBC", INDIRECT_Y, 2, 5, true);
+
+    // flag set
+    setOp(0x38, &C6502::SEC<IMPLIED>, "SEC", IMPLIED, 1, 2);
+    setOp(0xf8, &C6502::SED<IMPLIED>, "SED", IMPLIED, 1, 2);
+    setOp(0x78, &C6502::SEI<IMPLIED>, "SEI", IMPLIED, 1, 2);
+
+    // STA - store accumulator in memory
+    setOp(0x85, &C6502::STA<ZERO_PAGE>, "STA", ZERO_PAGE, 2, 3);
+    setOp(0x95, &C6502::STA<ZERO_PAGE_X>, "STA", ZERO_PAGE_X, 2, 4);
+    setOp(0x8d, &C6502::STA<ABSOLUTE>, "STA", ABSOLUTE, 3, 4);
+    setOp(0x9d, &C6502::STA<ABSOLUTE_X>, "STA", ABSOLUTE_X, 3, 5);
+    setOp(0x99, &C6502::STA<ABSOLUTE_Y>, "STA", ABSOLUTE_Y, 3, 5);
+    setOp(0x81, &C6502::STA<INDIRECT_X>, "STA", INDIRECT_X, 2, 6);
+    setOp(0x91, &C6502::STA<INDIRECT_Y>, "STA", INDIRECT_Y, 2, 6);
+
+    // STX - store register x in memory
+    setOp(0x86, &C6502::STX<ZERO_PAGE>, "STX", ZERO_PAGE, 2, 3);
+    setOp(0x96, &C6502::STX<ZERO_PAGE_Y>, "STX", ZERO_PAGE_Y, 2, 4);
+    setOp(0x8e, &C6502::STX<ABSOLUTE>, "STX", ABSOLUTE, 3, 4);
+
+    // STY - store register y in memory
+    setOp(0x84, &C6502::STY<ZERO_PAGE>, "STY", ZERO_PAGE, 2, 3);
+    setOp(0x94, &C6502::STY<ZERO_PAGE_X>, "STY", ZERO_PAGE_X, 2, 4);
+    setOp(0x8c, &C6502::STY<ABSOLUTE>, "STY", ABSOLUTE, 3, 4);
+
+    // register transfers
+    setOp(0xaa, &C6502::TAX<IMPLIED>, "TAX", IMPLIED, 1, 2);
+    setOp(0xa8, &C6502::TAY<IMPLIED>, "TAY", IMPLIED, 1, 2);
+    setOp(0xba, &C6502::TSX<IMPLIED>, "TSX", IMPLIED, 1, 2);
+    setOp(0x8a, &C6502::TXA<IMPLIED>, "TXA", IMPLIED, 1, 2);
+    setOp(0x9a, &C6502::TXS<IMPLIED>, "TXS", IMPLIED, 1, 2);
+    setOp(0x98, &C6502::TYA<IMPLIED>, "TYA", IMPLIED, 1, 2);
+
+    return true;
+}
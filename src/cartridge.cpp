@@ -2,80 +2,137 @@
 
 #include <iostream>
 #include <iomanip>
-#include <fstream>
+#include <cstring>
 
 Cartridge::Cartridge(std::string romfile)
 {
-
-    std::ifstream ifile;
-
     m_LoadedSuccessfully = false;
     m_ROMFileName = romfile;
 
-    // open rom file
-    ifile.open(m_ROMFileName.c_str(), std::ios::binary | std::ios::in);
+    m_ROMData = NULL;
+    m_ROMDataSize = 0;
+    m_Trainer = NULL;
+    m_PRGROM = NULL;
+    m_CHRROM = NULL;
+    memset(m_Header, 0, INES_HEADER_SIZE);
+
+    // map the rom file, shared with any other cartridge using it
+    m_ROMImage = ROMImage::open(m_ROMFileName);
 
-    if(!ifile.is_open()) return;
+    if(!m_ROMImage) return;
 
-    // read 16 byte header
-    for(int i = 0; i < 16; i++) m_Header[i] = uint8_t(ifile.get());
-    if(ifile.eof()) { ifile.close(); return; }
+    m_ROMData = m_ROMImage->getData();
+    m_ROMDataSize = m_ROMImage->getSize();
+
+    if(m_ROMDataSize < INES_HEADER_SIZE)
+    {
+        std::cout << "Error loading ROM, file is too small for a header." << std::endl;
+        return;
+    }
+
+    memcpy(m_Header, m_ROMData, INES_HEADER_SIZE);
+
+    if(!parseHeader()) return;
+
+    // trainer, PRG and CHR follow the header in that order
+    unsigned int offset = INES_HEADER_SIZE;
 
-    // read trainer if present
     if(hasTrainerData())
     {
-        m_Trainer = new uint8_t[512];
+        m_Trainer = &m_ROMData[offset];
+        offset += TRAINER_SIZE;
+    }
 
-        for(int i = 0; i < 512; i++) m_Trainer[i] = uint8_t(ifile.get());
+    // summed in 64 bits so huge header sizes can not wrap past the check
+    if(uint64_t(offset) + m_PRGROMSize + m_CHRROMSize > m_ROMDataSize)
+    {
+        std::cout << "Error loading ROM, file is smaller than the header sizes." << std::endl;
+        return;
     }
-    else m_Trainer = NULL;
 
-    // read PRG ROM - it better have prg data!
-    if(!getPRGROMSizeByte()) m_PRGROM = NULL;
-    else
+    if(m_PRGROMSize) m_PRGROM = &m_ROMData[offset];
+    offset += m_PRGROMSize;
+
+    if(m_CHRROMSize) m_CHRROM = &m_ROMData[offset];
+
+    m_LoadedSuccessfully = true;
+}
+
+Cartridge::~Cartridge()
+{
+    if(m_ROMImage) m_ROMImage->release();
+}
+
+bool Cartridge::getNES2ROMSize(uint8_t lsb, uint8_t msb, unsigned int banksize, unsigned int &size)
+{
+    // exponent-multiplier notation, 2^E * (MM*2+1) bytes, E goes up to 63
+    if(msb == 0xf)
     {
-        m_PRGROM = new uint8_t [0x8000];
+        if( (lsb >> 2) >= 32) return false;
 
-        for(int i = 0; i < 0x8000; i++)
-        {
-            // if PRG rom size is 1, mirror 0x0000-0x3ffff to 0x4000 - 0x7fff
-            if(getPRGROMSizeByte() == 1 && i >= 0x4000) m_PRGROM[i] = m_PRGROM[i-0x4000];
-            // else PRG rom size of 2 will fill
-            else m_PRGROM[i] = uint8_t(ifile.get());
+        uint64_t bytes = (uint64_t(1) << (lsb >> 2)) * ( (lsb & 0x3) * 2 + 1);
+        if(bytes > 0xffffffff) return false;
 
-            // check EOF error
-            if(ifile.eof()) { ifile.close(); return; }
-        }
+        size = bytes;
+        return true;
+    }
 
+    size = ( (msb << 8) | lsb) * banksize;
+    return true;
+}
+
+bool Cartridge::parseHeader()
+{
+    if(memcmp(m_Header, "NES\x1a", 4))
+    {
+        std::cout << "Error loading ROM, missing iNES signature." << std::endl;
+        return false;
     }
 
-    // read CHR ROM
-    if(!getCHRROMSizeByte()) m_CHRROM = NULL;
-    else
+    m_NES2 = (m_Header[7] & 0x0c) == 0x08;
+
+    if(m_NES2)
     {
-        m_CHRROM = new uint8_t [0x4000];
-        for(int i = 0; i < 0x4000; i++)
+        if(!getNES2ROMSize(m_Header[4], m_Header[9] & 0x0f, PRG_BANK_SIZE, m_PRGROMSize) ||
+           !getNES2ROMSize(m_Header[5], m_Header[9] >> 4, CHR_BANK_SIZE, m_CHRROMSize))
         {
-            // if CHR rom size is 1, mirror data
-            if(getCHRROMSizeByte() == 1 && i >= 0x2000) m_CHRROM[i] = m_CHRROM[i - 0x2000];
-            else m_CHRROM[i] = uint8_t(ifile.get());
-
-            // check EOF error
-            if(ifile.eof()) { ifile.close(); return; }
+            std::cout << "Error loading ROM, NES 2.0 ROM size is too large." << std::endl;
+            return false;
         }
 
+        // ram sizes are 64 << shift, 0 = none
+        m_PRGRAMSize = (m_Header[10] & 0x0f) ? (64 << (m_Header[10] & 0x0f)) : 0;
+        m_PRGRAMSize += (m_Header[10] >> 4) ? (64 << (m_Header[10] >> 4)) : 0;
+        m_CHRRAMSize = (m_Header[11] & 0x0f) ? (64 << (m_Header[11] & 0x0f)) : 0;
+        m_CHRRAMSize += (m_Header[11] >> 4) ? (64 << (m_Header[11] >> 4)) : 0;
+
+        m_Mapper = (m_Header[6] >> 4) | (m_Header[7] & 0xf0) | ( (m_Header[8] & 0x0f) << 8);
+        m_SubMapper = m_Header[8] >> 4;
     }
+    else
+    {
+        // old dumpers wrote text into bytes 7 - 15, only byte 6 can be trusted
+        if(m_Header[12] || m_Header[13] || m_Header[14] || m_Header[15])
+            memset(&m_Header[7], 0, INES_HEADER_SIZE - 7);
 
+        m_PRGROMSize = m_Header[4] * PRG_BANK_SIZE;
+        m_CHRROMSize = m_Header[5] * CHR_BANK_SIZE;
 
-    ifile.close();
-    m_LoadedSuccessfully = true;
-}
+        // byte 8 is rarely set, 0 means 8KB
+        m_PRGRAMSize = (m_Header[8] ? m_Header[8] : 1) * 0x2000;
+        m_CHRRAMSize = m_CHRROMSize ? 0 : CHR_BANK_SIZE;
 
-Cartridge::~Cartridge()
-{
-    if(m_Trainer) delete m_Trainer;
-    if(m_PRGROM) delete m_PRGROM;
-    if(m_CHRROM) delete m_CHRROM;
+        m_Mapper = (m_Header[6] >> 4) | (m_Header[7] & 0xf0);
+        m_SubMapper = 0;
+    }
+
+    if(!m_PRGROMSize)
+    {
+        std::cout << "Error loading ROM, no PRG ROM." << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
 void Cartridge::show()
@@ -85,17 +142,20 @@ void Cartridge::show()
     for(int i = 0; i < 16; i++) std::cout << std::hex << std::setw(2) << std::setfill('0') << int(m_Header[i]) << " ";
     std::cout << std::endl;
     std::cout << "Load successful    : " << loadSuccessful() << std::endl;
-    std::cout << "PRG ROM Size Byte  : 0x" << getPRGROMSizeByte() << std::endl;
-    std::cout << "CHR ROM Size Byte  : 0x" << getCHRROMSizeByte() << std::endl;
+    std::cout << "NES 2.0            : " << isNES2() << std::endl;
+    std::cout << "PRG ROM Size       : " << std::dec << getPRGROMSize() << std::endl;
+    std::cout << "CHR ROM Size       : " << std::dec << getCHRROMSize() << std::endl;
+    std::cout << "PRG RAM Size       : " << std::dec << getPRGRAMSize() << std::endl;
+    std::cout << "CHR RAM Size       : " << std::dec << getCHRRAMSize() << std::endl;
     std::cout << "Vertically Mirrored: " << isVerticallyMirrored() << std::endl;
     std::cout << "Battery-backed     : " << isBatteryBacked() << std::endl;
     std::cout << "Trainer Data       : " << hasTrainerData() << std::endl;
     std::cout << "Ignore Mirroring   : " << IgnoreMirroring() << std::endl;
-    std::cout << "Mapper Number      : 0x" << int(getMapperNumber()) << std::endl;
+    std::cout << "Mapper Number      : " << std::dec << int(getMapperNumber()) << "." << int(getSubMapperNumber()) << std::endl;
     std::cout << "VS Unisystem       : " << VSUnisystem() << std::endl;
     std::cout << "Playchoice-10      : " << PlayChoice10() << std::endl;
     std::cout << "PAL                : " << isPAL() << std::endl;
-    std::cout << "Video Type         : 0x" << getVideoType() << std::endl;
+    std::cout << "Video Type         : 0x" << std::hex << getVideoType() << std::endl;
     std::cout << "PRG RAM Present    : " << isPRGRAMPresent() << std::endl;
     std::cout << "Has Bus Conflicts  : " << hasBusConflicts() << std::endl;
 
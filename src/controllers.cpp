@@ -0,0 +1,81 @@
+#include "controllers.hpp"
+
+ControllerPorts::ControllerPorts()
+{
+    m_Buttons[0] = 0x0;
+    m_Buttons[1] = 0x0;
+
+    reset();
+}
+
+ControllerPorts::~ControllerPorts()
+{
+
+}
+
+void ControllerPorts::reset()
+{
+    m_Shift[0] = 0x0;
+    m_Shift[1] = 0x0;
+    m_Strobe = false;
+}
+
+void ControllerPorts::saveState(StateWriter &state)
+{
+    state.write(m_Shift, sizeof(m_Shift));
+    state.put(m_Strobe);
+}
+
+void ControllerPorts::loadState(StateReader &state)
+{
+    state.read(m_Shift, sizeof(m_Shift));
+    state.get(m_Strobe);
+}
+
+void ControllerPorts::mapRegisters(MemoryMap *cpumem)
+{
+    std::cout << "Controller ports exposed to CPU memory." << std::endl;
+
+    cpumem->mapHandler(JOYPAD1, JOYPAD1, this);
+    cpumem->mapReadHandler(JOYPAD2, JOYPAD2, this);
+}
+
+void ControllerPorts::setButtons(int port, uint8_t buttons)
+{
+    if(port < 0 || port > 1)
+    {
+        std::cout << "Error setting controller buttons, invalid port " << port << std::endl;
+        return;
+    }
+
+    m_Buttons[port] = buttons;
+    if(m_Strobe) m_Shift[port] = buttons;
+}
+
+uint8_t ControllerPorts::memRead(uint16_t address)
+{
+    int port = (address == JOYPAD2) ? 1 : 0;
+
+    // while strobe is high the first button is read continuously
+    if(m_Strobe) return 0x40 | (m_Buttons[port] & 0x1);
+
+    // after 8 reads the shift register returns 1s
+    uint8_t val = m_Shift[port] & 0x1;
+    m_Shift[port] = (m_Shift[port] >> 1) | 0x80;
+
+    // upper bits are open bus, usually the high byte of the address
+    return 0x40 | val;
+}
+
+void ControllerPorts::memWrite(uint16_t address, uint8_t val)
+{
+    if(address != JOYPAD1) return;
+
+    m_Strobe = val & 0x1;
+
+    if(m_Strobe)
+    {
+        m_Shift[0] = m_Buttons[0];
+        m_Shift[1] = m_Buttons[1];
+    }
+}
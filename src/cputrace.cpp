@@ -0,0 +1,127 @@
+#include "cputrace.hpp"
+#include "c6502.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+
+CPUTrace::CPUTrace(unsigned int capacity)
+{
+    m_Capacity = 1;
+    while(m_Capacity < capacity) m_Capacity <<= 1;
+    m_Mask = m_Capacity - 1;
+
+    m_Records = new CPUTraceRecord[m_Capacity];
+    memset(m_Records, 0, sizeof(CPUTraceRecord) * m_Capacity);
+
+    m_Written.store(0);
+}
+
+CPUTrace::~CPUTrace()
+{
+    delete [] m_Records;
+}
+
+unsigned int CPUTrace::copyLast(CPUTraceRecord *buf, unsigned int count)
+{
+    uint64_t end = m_Written.load(std::memory_order_acquire);
+
+    uint64_t n = count;
+    if(n > m_Capacity) n = m_Capacity;
+    if(n > end) n = end;
+
+    uint64_t start = end - n;
+    for(uint64_t i = start; i < end; i++) buf[i - start] = m_Records[i & m_Mask];
+
+    // the writer may have lapped the oldest records while they were copied, the fence keeps
+    // the copies above from moving past the load
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t written = m_Written.load(std::memory_order_relaxed);
+
+    // record written may be half stored over record written - capacity, drop it as well
+    if(written >= start + m_Capacity)
+    {
+        uint64_t lost = written + 1 - m_Capacity - start;
+        if(lost >= n) return 0;
+
+        memmove(buf, buf + lost, sizeof(CPUTraceRecord) * (n - lost));
+        n -= lost;
+    }
+
+    return (unsigned int)n;
+}
+
+bool CPUTrace::save(std::string filename, unsigned int count)
+{
+    if(count == 0 || count > m_Capacity) count = m_Capacity;
+
+    CPUTraceRecord *buf = new CPUTraceRecord[count];
+    count = copyLast(buf, count);
+
+    std::ofstream ofile(filename.c_str(), std::ios::binary);
+    if(!ofile.is_open())
+    {
+        std::cout << "Error opening trace file " << filename << std::endl;
+        delete [] buf;
+        return false;
+    }
+
+    CPUTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CPUTRACE_MAGIC, 8);
+    header.version = CPUTRACE_VERSION;
+    header.recordsize = sizeof(CPUTraceRecord);
+    header.count = count;
+
+    ofile.write((const char*)&header, sizeof(header));
+    ofile.write((const char*)buf, sizeof(CPUTraceRecord) * count);
+
+    delete [] buf;
+
+    std::cout << "Saved " << std::dec << count << " trace records to " << filename << std::endl;
+
+    return ofile.good();
+}
+
+bool CPUTrace::decode(std::string filename, std::ostream &out)
+{
+    std::ifstream ifile(filename.c_str(), std::ios::binary);
+    if(!ifile.is_open())
+    {
+        std::cout << "Error opening trace file " << filename << std::endl;
+        return false;
+    }
+
+    CPUTraceHeader header;
+    ifile.read((char*)&header, sizeof(header));
+
+    if(!ifile.good() || memcmp(header.magic, CPUTRACE_MAGIC, 8))
+    {
+        std::cout << "Not a trace file : " << filename << std::endl;
+        return false;
+    }
+
+    if(header.version != CPUTRACE_VERSION || header.recordsize != sizeof(CPUTraceRecord))
+    {
+        std::cout << "Unsupported trace version " << header.version << std::endl;
+        return false;
+    }
+
+    out << std::uppercase << std::hex << std::setfill('0');
+
+    for(uint32_t i = 0; i < header.count; i++)
+    {
+        CPUTraceRecord r;
+        if(!ifile.read((char*)&r, sizeof(r))) break;
+
+        out << std::setw(4) << int(r.pc) << "  " << std::setw(2) << int(r.opcode) << "  ";
+        out << C6502::getOpName(r.opcode) << "  ";
+        out << "A:" << std::setw(2) << int(r.a) << " X:" << std::setw(2) << int(r.x) << " Y:" << std::setw(2) << int(r.y);
+        out << " P:" << std::setw(2) << int(r.p) << " SP:" << std::setw(2) << int(r.sp);
+        out << " CYC:" << std::dec << r.cycles << std::hex << "\n";
+    }
+
+    out << std::dec << std::setfill(' ') << std::nouppercase;
+
+    return true;
+}
@@ -1,15 +1,221 @@
 #include "nes.hpp"
 
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+void printUsage()
+{
+    std::cout << "usage: nesemu [rom.nes]" << std::endl;
+    std::cout << "       nesemu --headless --frames <n> [--runahead <n>] [--cputrace trace.bin] [--wav out.wav] [--noaudio] rom.nes" << std::endl;
+    std::cout << "       nesemu --nestest [--log nestest.log] [--trace out.log] nestest.nes" << std::endl;
+    std::cout << "       nesemu --statecheck --frames <n> [--runahead <n>] rom.nes" << std::endl;
+    std::cout << "       nesemu --decodetrace trace.bin" << std::endl;
+}
+
+// mono 16 bit pcm wav
+bool saveWav(std::string filename, const std::vector<int16_t> &samples)
+{
+    std::ofstream ofile(filename.c_str(), std::ios::binary);
+    if(!ofile.is_open())
+    {
+        std::cout << "Error opening wav file " << filename << std::endl;
+        return false;
+    }
+
+    uint32_t datasize = samples.size() * sizeof(int16_t);
+    uint32_t riffsize = 36 + datasize;
+    uint32_t fmtsize = 16;
+    uint16_t format = 1;
+    uint16_t channels = 1;
+    uint32_t rate = AUDIO_SAMPLE_RATE;
+    uint32_t byterate = AUDIO_SAMPLE_RATE * sizeof(int16_t);
+    uint16_t align = sizeof(int16_t);
+    uint16_t bits = 16;
+
+    ofile.write("RIFF", 4);
+    ofile.write((const char*)&riffsize, 4);
+    ofile.write("WAVEfmt ", 8);
+    ofile.write((const char*)&fmtsize, 4);
+    ofile.write((const char*)&format, 2);
+    ofile.write((const char*)&channels, 2);
+    ofile.write((const char*)&rate, 4);
+    ofile.write((const char*)&byterate, 4);
+    ofile.write((const char*)&align, 2);
+    ofile.write((const char*)&bits, 2);
+    ofile.write("data", 4);
+    ofile.write((const char*)&datasize, 4);
+    if(datasize) ofile.write((const char*)&samples[0], datasize);
+
+    std::cout << "Wrote " << samples.size() << " samples to " << filename << std::endl;
+
+    return ofile.good();
+}
+
+// run a number of frames without the console and report throughput
+// the audio of the run is kept if wavfile is given
+int runHeadless(NES &nes, int frames, std::string wavfile)
+{
+    std::vector<int16_t> audio;
+    int16_t samples[AUDIORING_DEFAULT_SIZE];
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    int framesrun = 0;
+    while(framesrun < frames)
+    {
+        if(!nes.runFrame()) break;
+        framesrun++;
+
+        if(!wavfile.empty())
+        {
+            unsigned int count = nes.readAudio(samples, AUDIORING_DEFAULT_SIZE);
+            audio.insert(audio.end(), samples, samples + count);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count();
+    if(seconds <= 0.0) seconds = 1e-9;
+
+    double emulated = nes.getCPUCycles() / nes.getCPUClockRate();
+
+    std::cout << "Frames          : " << std::dec << framesrun << std::endl;
+    std::cout << "Instructions    : " << nes.getInstructionCount() << std::endl;
+    std::cout << "CPU Cycles      : " << nes.getCPUCycles() << std::endl;
+    std::cout << "Host time       : " << seconds << " s" << std::endl;
+    std::cout << "Frames/sec      : " << framesrun / seconds << std::endl;
+    std::cout << "Instructions/sec: " << nes.getInstructionCount() / seconds << std::endl;
+    std::cout << "Realtime ratio  : " << emulated / seconds << "x" << std::endl;
+
+    if(!wavfile.empty()) saveWav(wavfile, audio);
+
+    return framesrun == frames ? 0 : 1;
+}
+
+// save a state after some frames, run on, load it back and check it saves the same bytes
+int runStateCheck(NES &nes, int frames)
+{
+    std::vector<uint8_t> saved(nes.getStateSize());
+    std::vector<uint8_t> loaded(nes.getStateSize());
+
+    for(int i = 0; i < frames; i++) nes.runFrame();
+    unsigned int size = nes.saveState(&saved[0], saved.size());
+
+    for(int i = 0; i < frames; i++) nes.runFrame();
+
+    if(!nes.loadState(&saved[0], size))
+    {
+        std::cout << "Error loading the saved state." << std::endl;
+        return 1;
+    }
+
+    if(nes.saveState(&loaded[0], loaded.size()) != size)
+    {
+        std::cout << "State saved back with a different size." << std::endl;
+        return 1;
+    }
+
+    unsigned int differ = 0;
+    for(unsigned int i = 0; i < size; i++) if(saved[i] != loaded[i]) differ++;
+
+    if(differ)
+    {
+        std::cout << "Loaded state saves back with " << std::dec << differ << " of " << size << " bytes different." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Loaded state saves back identical, " << std::dec << size << " bytes." << std::endl;
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
+    bool headless = false;
+    bool nestest = false;
+    bool statecheck = false;
+    int frames = 0;
+    int runahead = 0;
+    std::string reflog;
+    std::string tracefile;
+    std::string cputrace;
+    std::string wavfile;
+    bool audio = true;
+    std::string romfile = ".\\test\\mytest.nes";
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--headless")) headless = true;
+        else if(!strcmp(argv[i], "--frames") && i + 1 < argc) frames = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--runahead") && i + 1 < argc) runahead = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--nestest")) nestest = true;
+        else if(!strcmp(argv[i], "--statecheck")) statecheck = true;
+        else if(!strcmp(argv[i], "--log") && i + 1 < argc) reflog = argv[++i];
+        else if(!strcmp(argv[i], "--trace") && i + 1 < argc) tracefile = argv[++i];
+        else if(!strcmp(argv[i], "--cputrace") && i + 1 < argc) cputrace = argv[++i];
+        else if(!strcmp(argv[i], "--wav") && i + 1 < argc) wavfile = argv[++i];
+        else if(!strcmp(argv[i], "--noaudio")) audio = false;
+        else if(!strcmp(argv[i], "--decodetrace") && i + 1 < argc)
+        {
+            return CPUTrace::decode(argv[i + 1], std::cout) ? 0 : 1;
+        }
+        else if(argv[i][0] == '-')
+        {
+            printUsage();
+            return 1;
+        }
+        else romfile = argv[i];
+    }
 
     NES nes;
 
-    nes.loadCartridge(".\\test\\mytest.nes");
+    // exit code 0 if the cpu trace matches and nestest reports no errors
+    if(nestest)
+    {
+        if(!nes.loadCartridge(romfile)) return 1;
 
-    nes.debugConsole("NES> ");
+        return nes.runNestest(reflog, tracefile) ? 0 : 1;
+    }
+
+    // exit code 0 if a loaded state saves back byte for byte
+    if(statecheck)
+    {
+        if(frames <= 0 || !nes.loadCartridge(romfile))
+        {
+            printUsage();
+            return 1;
+        }
+
+        if(runahead > 0) nes.setRunAhead(runahead);
+
+        return runStateCheck(nes, frames);
+    }
+
+    if(headless)
+    {
+        if(frames <= 0 || !nes.loadCartridge(romfile))
+        {
+            printUsage();
+            return 1;
+        }
+
+        if(runahead > 0) nes.setRunAhead(runahead);
+        nes.setAudioEnabled(audio);
 
+        // the last instructions are written out when the run ends, including on a jam
+        if(!cputrace.empty()) nes.enableTrace(CPUTRACE_DEFAULT_SIZE);
 
+        int result = runHeadless(nes, frames, wavfile);
+
+        if(!cputrace.empty()) nes.saveTrace(cputrace);
+
+        return result;
+    }
+
+    nes.loadCartridge(romfile);
+
+    nes.debugConsole("NES> ");
 
     return 0;
 }
@@ -0,0 +1,250 @@
+#include "mapper.hpp"
+
+#include <cstring>
+
+Mapper::Mapper(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+{
+    m_Cartridge = cartridge;
+    m_MemCPU = cpumem;
+    m_MemPPU = ppumem;
+    m_PPU = ppu;
+    m_CPU = cpu;
+
+    m_PRGROM = m_Cartridge->getPRGROM();
+    m_PRGROMSize = m_Cartridge->getPRGROMSize();
+    m_CHRROM = m_Cartridge->getCHRROM();
+    m_CHRROMSize = m_Cartridge->getCHRROMSize();
+
+    m_CHRRAM = NULL;
+    m_CHRRAMSize = 0;
+
+    m_Restoring = false;
+
+    if(!m_CHRROMSize)
+    {
+        m_CHRRAMSize = m_Cartridge->getCHRRAMSize();
+        if(m_CHRRAMSize < CHR_8K) m_CHRRAMSize = CHR_8K;
+
+        m_CHRRAM = new uint8_t[m_CHRRAMSize];
+        memset(m_CHRRAM, 0, m_CHRRAMSize);
+    }
+
+    for(int i = 0; i < 8; i++) m_CHRPages[i] = NULL;
+}
+
+Mapper::~Mapper()
+{
+    if(m_CHRRAM) delete [] m_CHRRAM;
+}
+
+Mapper *Mapper::create(Cartridge *cartridge, MemoryMap *cpumem, MemoryMap *ppumem, C2C02 *ppu, C6502 *cpu)
+{
+    switch(cartridge->getMapperNumber())
+    {
+    case 0:
+        return new MapperNROM(cartridge, cpumem, ppumem, ppu, cpu);
+    case 1:
+        return new MapperMMC1(cartridge, cpumem, ppumem, ppu, cpu);
+    case 2:
+        return new MapperUxROM(cartridge, cpumem, ppumem, ppu, cpu);
+    case 3:
+        return new MapperCNROM(cartridge, cpumem, ppumem, ppu, cpu);
+    case 4:
+        return new MapperMMC3(cartridge, cpumem, ppumem, ppu, cpu);
+    case 7:
+        return new MapperAxROM(cartridge, cpumem, ppumem, ppu, cpu);
+    default:
+        break;
+    }
+
+    std::cout << "Mapper " << std::dec << cartridge->getMapperNumber() << " is not supported." << std::endl;
+
+    return NULL;
+}
+
+void Mapper::reset()
+{
+    // first bank at 0x8000, last bank at 0xc000, a single 16KB bank shows in both
+    mapPRG(0x8000, PRG_16K, 0);
+    mapPRG(0xc000, PRG_16K, -1);
+    mapCHR(0x0000, CHR_8K, 0);
+
+    // nametable layout from the header
+    if(m_Cartridge->IgnoreMirroring()) setMirroring(MIRROR_FOUR_SCREEN);
+    else if(m_Cartridge->isVerticallyMirrored()) setMirroring(MIRROR_VERTICAL);
+    else setMirroring(MIRROR_HORIZONTAL);
+
+    // registers, PRG ROM reads are unaffected
+    m_MemCPU->mapWriteHandler(0x8000, 0xffff, this);
+}
+
+void Mapper::saveState(StateWriter &state)
+{
+    if(m_CHRRAM) state.write(m_CHRRAM, m_CHRRAMSize);
+}
+
+void Mapper::loadState(StateReader &state)
+{
+    if(!m_CHRRAM) return;
+
+    // the mapped pages do not change, drop the tiles decoded from the old contents
+    state.read(m_CHRRAM, m_CHRRAMSize);
+    m_PPU->invalidateTiles(0x0000, 0x1fff);
+}
+
+void Mapper::restoreState(StateReader &state)
+{
+    m_Restoring = true;
+    loadState(state);
+    m_Restoring = false;
+}
+
+void Mapper::mapPRG(uint16_t address, unsigned int size, int bank)
+{
+    const int count = m_PRGROMSize / size;
+
+    // roms smaller than the bank repeat
+    if(!count)
+    {
+        for(unsigned int i = 0; i < size; i += m_PRGROMSize) m_MemCPU->mapROM(address + i, address + i + m_PRGROMSize - 1, m_PRGROM);
+        return;
+    }
+
+    if(bank < 0) bank += count;
+    bank %= count;
+
+    m_MemCPU->mapROM(address, address + size - 1, m_PRGROM + bank * size);
+}
+
+void Mapper::mapCHR(uint16_t address, unsigned int size, int bank)
+{
+    const uint8_t *chr = m_CHRROM ? m_CHRROM : m_CHRRAM;
+    const int count = (m_CHRROM ? m_CHRROMSize : m_CHRRAMSize) / size;
+
+    if(!count) return;
+
+    if(bank < 0) bank += count;
+    bank %= count;
+
+    const unsigned int offset = bank * size;
+    chr += offset;
+
+    // tiles only need decoding again if the bank is different
+    bool changed = false;
+    for(unsigned int i = 0; i < size / CHR_1K; i++)
+    {
+        const uint8_t *page = chr + i * CHR_1K;
+        if(m_CHRPages[ (address / CHR_1K) + i] != page)
+        {
+            m_CHRPages[ (address / CHR_1K) + i] = page;
+            changed = true;
+        }
+    }
+
+    if(!changed) return;
+
+    // the PPU may lag the CPU, what it has still to draw uses the old bank
+    if(!m_Restoring) m_PPU->sync();
+
+    if(m_CHRROM) m_MemPPU->mapROM(address, address + size - 1, chr);
+    else m_MemPPU->mapRAM(address, address + size - 1, m_CHRRAM + offset);
+
+    m_PPU->invalidateTiles(address, address + size - 1);
+}
+
+void Mapper::setMirroring(MIRRORING mirroring)
+{
+    // four screen carts ignore mirroring control
+    if(m_Cartridge->IgnoreMirroring()) mirroring = MIRROR_FOUR_SCREEN;
+
+    if(!m_Restoring) m_PPU->sync();
+    m_PPU->setMirroring(mirroring);
+}
+
+/////////////////////////////////////////////
+// UxROM
+
+void MapperUxROM::reset()
+{
+    Mapper::reset();
+
+    m_Bank = 0x0;
+}
+
+void MapperUxROM::memWrite(uint16_t /*address*/, uint8_t val)
+{
+    m_Bank = val;
+    mapPRG(0x8000, PRG_16K, m_Bank);
+}
+
+void MapperUxROM::saveState(StateWriter &state)
+{
+    Mapper::saveState(state);
+    state.put(m_Bank);
+}
+
+void MapperUxROM::loadState(StateReader &state)
+{
+    Mapper::loadState(state);
+    state.get(m_Bank);
+    mapPRG(0x8000, PRG_16K, m_Bank);
+}
+
+/////////////////////////////////////////////
+// CNROM
+
+void MapperCNROM::reset()
+{
+    Mapper::reset();
+
+    m_Bank = 0x0;
+}
+
+void MapperCNROM::memWrite(uint16_t /*address*/, uint8_t val)
+{
+    m_Bank = val;
+    mapCHR(0x0000, CHR_8K, m_Bank);
+}
+
+void MapperCNROM::saveState(StateWriter &state)
+{
+    Mapper::saveState(state);
+    state.put(m_Bank);
+}
+
+void MapperCNROM::loadState(StateReader &state)
+{
+    Mapper::loadState(state);
+    state.get(m_Bank);
+    mapCHR(0x0000, CHR_8K, m_Bank);
+}
+
+/////////////////////////////////////////////
+// AxROM
+
+void MapperAxROM::reset()
+{
+    Mapper::reset();
+
+    memWrite(0x8000, 0x0);
+}
+
+void MapperAxROM::memWrite(uint16_t /*address*/, uint8_t val)
+{
+    m_Bank = val;
+    mapPRG(0x8000, PRG_32K, m_Bank & 0x7);
+    setMirroring( (m_Bank & 0x10) ? MIRROR_SINGLE_HIGH : MIRROR_SINGLE_LOW);
+}
+
+void MapperAxROM::saveState(StateWriter &state)
+{
+    Mapper::saveState(state);
+    state.put(m_Bank);
+}
+
+void MapperAxROM::loadState(StateReader &state)
+{
+    Mapper::loadState(state);
+    state.get(m_Bank);
+    memWrite(0x8000, m_Bank);
+}
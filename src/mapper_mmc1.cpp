@@ -0,0 +1,121 @@
+#include "mapper.hpp"
+
+void MapperMMC1::reset()
+{
+    Mapper::reset();
+
+    m_Shift = 0x0;
+    m_ShiftCount = 0;
+
+    // power on in PRG mode 3, last bank fixed at 0xc000
+    m_Control = 0x0c;
+    m_CHRBank0 = 0x0;
+    m_CHRBank1 = 0x0;
+    m_PRGBank = 0x0;
+
+    updateBanks();
+}
+
+void MapperMMC1::memWrite(uint16_t address, uint8_t val)
+{
+    // bit 7 resets the shift register and locks the last bank at 0xc000
+    if(val & 0x80)
+    {
+        m_Shift = 0x0;
+        m_ShiftCount = 0;
+        m_Control |= 0x0c;
+        updateBanks();
+        return;
+    }
+
+    // 5 serial writes, lsb first, the 5th write's address picks the register
+    m_Shift |= (val & 0x1) << m_ShiftCount;
+    m_ShiftCount++;
+
+    if(m_ShiftCount < 5) return;
+
+    switch( (address >> 13) & 0x3)
+    {
+    case 0:
+        m_Control = m_Shift;
+        break;
+    case 1:
+        m_CHRBank0 = m_Shift;
+        break;
+    case 2:
+        m_CHRBank1 = m_Shift;
+        break;
+    case 3:
+        m_PRGBank = m_Shift;
+        break;
+    }
+
+    m_Shift = 0x0;
+    m_ShiftCount = 0;
+
+    updateBanks();
+}
+
+void MapperMMC1::saveState(StateWriter &state)
+{
+    Mapper::saveState(state);
+
+    state.put(m_Shift);
+    state.put(m_ShiftCount);
+    state.put(m_Control);
+    state.put(m_CHRBank0);
+    state.put(m_CHRBank1);
+    state.put(m_PRGBank);
+}
+
+void MapperMMC1::loadState(StateReader &state)
+{
+    Mapper::loadState(state);
+
+    state.get(m_Shift);
+    state.get(m_ShiftCount);
+    state.get(m_Control);
+    state.get(m_CHRBank0);
+    state.get(m_CHRBank1);
+    state.get(m_PRGBank);
+
+    updateBanks();
+}
+
+void MapperMMC1::updateBanks()
+{
+    static const MIRRORING mirroring[4] = { MIRROR_SINGLE_LOW, MIRROR_SINGLE_HIGH, MIRROR_VERTICAL, MIRROR_HORIZONTAL};
+
+    setMirroring(mirroring[m_Control & 0x3]);
+
+    // 512KB boards use CHR bank bit 4 to select the 256KB PRG half
+    int outer = (m_PRGROMSize > 0x40000) ? (m_CHRBank0 & 0x10) : 0;
+    int bank = outer | (m_PRGBank & 0x0f);
+
+    switch( (m_Control >> 2) & 0x3)
+    {
+    // 32KB, low bit ignored
+    case 0:
+    case 1:
+        mapPRG(0x8000, PRG_32K, bank >> 1);
+        break;
+    // first bank fixed at 0x8000
+    case 2:
+        mapPRG(0x8000, PRG_16K, outer);
+        mapPRG(0xc000, PRG_16K, bank);
+        break;
+    // last bank fixed at 0xc000
+    case 3:
+        mapPRG(0x8000, PRG_16K, bank);
+        mapPRG(0xc000, PRG_16K, outer | 0x0f);
+        break;
+    }
+
+    // 8KB or two 4KB CHR banks
+    if(m_Control & 0x10)
+    {
+        mapCHR(0x0000, CHR_4K, m_CHRBank0);
+        mapCHR(0x1000, CHR_4K, m_CHRBank1);
+    }
+    else mapCHR(0x0000, CHR_8K, m_CHRBank0 >> 1);
+}
@@ -0,0 +1,156 @@
+#include "mapper.hpp"
+
+MapperMMC3::~MapperMMC3()
+{
+    m_PPU->setA12Listener(NULL);
+    m_CPU->setIRQLine(IRQ_MAPPER, false);
+}
+
+void MapperMMC3::reset()
+{
+    Mapper::reset();
+
+    m_PPU->setA12Listener(this);
+
+    m_BankSelect = 0x0;
+
+    // R0 - R5 CHR, R6 - R7 PRG
+    for(int i = 0; i < 8; i++) m_Banks[i] = 0x0;
+    m_Banks[1] = 2;
+    m_Banks[3] = 1;
+    m_Banks[4] = 2;
+    m_Banks[5] = 3;
+    m_Banks[7] = 1;
+
+    m_IRQLatch = 0x0;
+    m_IRQCounter = 0x0;
+    m_IRQReload = false;
+    m_IRQEnabled = false;
+    m_CPU->setIRQLine(IRQ_MAPPER, false);
+
+    updateBanks();
+}
+
+void MapperMMC3::memWrite(uint16_t address, uint8_t val)
+{
+    // A12 rises the PPU has still to run belong to the irq state before the write
+    if(address >= 0xc000) m_PPU->catchUp();
+
+    // registers are selected by address range and even / odd address
+    switch( (address & 0xe000) | (address & 0x1))
+    {
+    case 0x8000:
+        m_BankSelect = val;
+        updateBanks();
+        break;
+    case 0x8001:
+        m_Banks[m_BankSelect & 0x7] = val;
+        updateBanks();
+        break;
+    case 0xa000:
+        setMirroring( (val & 0x1) ? MIRROR_HORIZONTAL : MIRROR_VERTICAL);
+        break;
+    case 0xa001:
+        // PRG RAM protect, ram is always enabled
+        break;
+    // irq writes move the predicted irq
+    case 0xc000:
+        m_IRQLatch = val;
+        m_CPU->endSlice();
+        break;
+    case 0xc001:
+        m_IRQCounter = 0x0;
+        m_IRQReload = true;
+        m_CPU->endSlice();
+        break;
+    case 0xe000:
+        m_IRQEnabled = false;
+        m_CPU->setIRQLine(IRQ_MAPPER, false);
+        m_CPU->endSlice();
+        break;
+    case 0xe001:
+        m_IRQEnabled = true;
+        m_CPU->endSlice();
+        break;
+    }
+}
+
+void MapperMMC3::a12Rise()
+{
+    // reload on zero or request, otherwise count down
+    if(!m_IRQCounter || m_IRQReload)
+    {
+        m_IRQCounter = m_IRQLatch;
+        m_IRQReload = false;
+    }
+    else m_IRQCounter--;
+
+    if(!m_IRQCounter && m_IRQEnabled) m_CPU->setIRQLine(IRQ_MAPPER, true);
+}
+
+uint64_t MapperMMC3::getNextEventCycle()
+{
+    if(!m_IRQEnabled) return NO_EVENT;
+
+    // rises until the counter reaches zero, a reload takes one rise
+    unsigned int rises;
+    if(!m_IRQCounter || m_IRQReload) rises = 1 + m_IRQLatch;
+    else rises = m_IRQCounter;
+
+    return m_PPU->getA12RiseCycle(rises);
+}
+
+void MapperMMC3::saveState(StateWriter &state)
+{
+    Mapper::saveState(state);
+
+    state.put(m_BankSelect);
+    state.write(m_Banks, sizeof(m_Banks));
+    state.put(m_IRQLatch);
+    state.put(m_IRQCounter);
+    state.put(m_IRQReload);
+    state.put(m_IRQEnabled);
+}
+
+void MapperMMC3::loadState(StateReader &state)
+{
+    Mapper::loadState(state);
+
+    state.get(m_BankSelect);
+    state.read(m_Banks, sizeof(m_Banks));
+    state.get(m_IRQLatch);
+    state.get(m_IRQCounter);
+    state.get(m_IRQReload);
+    state.get(m_IRQEnabled);
+
+    // the irq line itself is restored with the CPU
+    updateBanks();
+}
+
+void MapperMMC3::updateBanks()
+{
+    // PRG mode, swaps 0x8000 and 0xc000
+    if(m_BankSelect & 0x40)
+    {
+        mapPRG(0x8000, PRG_8K, -2);
+        mapPRG(0xc000, PRG_8K, m_Banks[6] & 0x3f);
+    }
+    else
+    {
+        mapPRG(0x8000, PRG_8K, m_Banks[6] & 0x3f);
+        mapPRG(0xc000, PRG_8K, -2);
+    }
+    mapPRG(0xa000, PRG_8K, m_Banks[7] & 0x3f);
+    mapPRG(0xe000, PRG_8K, -1);
+
+    // CHR A12 inversion, swaps the 2KB and 1KB halves
+    uint16_t big = (m_BankSelect & 0x80) ? 0x1000 : 0x0000;
+    uint16_t small = big ^ 0x1000;
+
+    mapCHR(big, CHR_2K, m_Banks[0] >> 1);
+    mapCHR(big + CHR_2K, CHR_2K, m_Banks[1] >> 1);
+    mapCHR(small, CHR_1K, m_Banks[2]);
+    mapCHR(small + CHR_1K, CHR_1K, m_Banks[3]);
+    mapCHR(small + CHR_2K, CHR_1K, m_Banks[4]);
+    mapCHR(small + CHR_2K + CHR_1K, CHR_1K, m_Banks[5]);
+}
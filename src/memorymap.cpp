@@ -1,17 +1,30 @@
 #include "memorymap.hpp"
 
+#include <cstring>
+
 MemoryMap::MemoryMap(unsigned int memsize)
 {
+    // memory is a power of two number of whole pages
+    if(memsize < MEMPAGE_SIZE || (memsize & (memsize - 1)) )
+    {
+        std::cout << "MemoryMap error, size " << memsize << " is not a power of two multiple of the page size." << std::endl;
+        memsize = MEMPAGE_SIZE;
+    }
+
     m_MemSize = memsize;
+    m_AddressMask = m_MemSize - 1;
+    m_PageCount = m_MemSize >> MEMPAGE_SHIFT;
 
     // init memory array
     m_Mem = new uint8_t[m_MemSize];
 
-    // init memory map array
-    m_MemMap = new uint8_t*[m_MemSize];
+    // init page table
+    m_Pages = new MemoryPage[m_PageCount];
+    m_RangeHandlers = new MemoryRangeHandler*[m_PageCount];
+    for(unsigned int i = 0; i < m_PageCount; i++) m_RangeHandlers[i] = NULL;
 
-    // assign memory map indices to match memory indices
-    for(unsigned int i = 0; i < m_MemSize; i++) m_MemMap[i] = &m_Mem[i];
+    // assign pages to match memory
+    clearMirror(0, m_MemSize - 1);
 
     // clear memory
     clear();
@@ -19,12 +32,37 @@ MemoryMap::MemoryMap(unsigned int memsize)
 
 MemoryMap::~MemoryMap()
 {
-    delete m_MemMap;
+    for(unsigned int i = 0; i < m_PageCount; i++)
+        if(m_RangeHandlers[i]) delete m_RangeHandlers[i];
+    delete [] m_RangeHandlers;
+    delete [] m_Pages;
+    delete [] m_Mem;
+}
+
+bool MemoryMap::checkPageRange(const char *caller, unsigned int startaddress, unsigned int endaddress)
+{
+    if( startaddress > endaddress)
+    {
+        std::cout << "MemoryMap " << caller << " error, start address > endaddress." << std::endl;
+        return false;
+    }
+    if(startaddress >= m_MemSize || endaddress >= m_MemSize)
+    {
+        std::cout << "MemoryMap " << caller << " error, range outside of memory." << std::endl;
+        return false;
+    }
+    if( (startaddress & MEMPAGE_MASK) || ( (endaddress + 1) & MEMPAGE_MASK) )
+    {
+        std::cout << "MemoryMap " << caller << " error, range is not aligned to " << MEMPAGE_SIZE << " byte pages." << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
 void MemoryMap::clear()
 {
-    for(unsigned int i = 0; i < m_MemSize; i++) *m_MemMap[i] = 0x0;
+    memset(m_Mem, 0x0, m_MemSize);
 }
 
 bool MemoryMap::clear(unsigned int startaddress, unsigned int endaddress)
@@ -40,7 +78,12 @@ bool MemoryMap::clear(unsigned int startaddress, unsigned int endaddress)
         return false;
     }
 
-    for(unsigned int i = startaddress; i <= endaddress; i++) *m_MemMap[i] = 0x0;
+    // only memory backed pages are cleared, handled pages are left alone
+    for(unsigned int i = startaddress; i <= endaddress; i++)
+    {
+        uint8_t *mem = getPointer(i);
+        if(mem) *mem = 0x0;
+    }
 
     return true;
 }
@@ -53,7 +96,7 @@ bool MemoryMap::write(unsigned int address, uint8_t val)
         return false;
     }
 
-    *m_MemMap[address] = val;
+    busWrite(address, val);
 
     return true;
 }
@@ -66,7 +109,31 @@ uint8_t MemoryMap::read(unsigned int address)
         return false;
     }
 
-    return *m_MemMap[address];
+    return busRead(address);
+}
+
+uint8_t *MemoryMap::getPointer(unsigned int address)
+{
+    address &= m_AddressMask;
+
+    const MemoryPage &page = m_Pages[address >> MEMPAGE_SHIFT];
+
+    if(page.write) return &page.write[address & MEMPAGE_MASK];
+    return NULL;
+}
+
+void MemoryMap::resetPage(unsigned int page, unsigned int mempage)
+{
+    if(m_RangeHandlers[page])
+    {
+        delete m_RangeHandlers[page];
+        m_RangeHandlers[page] = NULL;
+    }
+
+    m_Pages[page].read = &m_Mem[mempage << MEMPAGE_SHIFT];
+    m_Pages[page].write = &m_Mem[mempage << MEMPAGE_SHIFT];
+    m_Pages[page].readHandler = NULL;
+    m_Pages[page].writeHandler = NULL;
 }
 
 bool MemoryMap::mirror(unsigned int start1, unsigned int end1, unsigned int start2, unsigned int end2)
@@ -83,10 +150,15 @@ bool MemoryMap::mirror(unsigned int start1, unsigned int end1, unsigned int star
         return false;
     }
 
-    for(int i = 0; i <= int(end1 - start1); i++)
+    if(!checkPageRange("mirror", start1, end1) || !checkPageRange("mirror", start2, end2)) return false;
+
+    for(unsigned int i = 0; i <= ( (end1 - start1) >> MEMPAGE_SHIFT); i++)
     {
-        m_MemMap[start1 + i] = &m_Mem[start1 + i];
-        m_MemMap[start2 + i] = &m_Mem[start1 + i];
+        unsigned int page1 = (start1 >> MEMPAGE_SHIFT) + i;
+        unsigned int page2 = (start2 >> MEMPAGE_SHIFT) + i;
+
+        resetPage(page1, page1);
+        resetPage(page2, page1);
     }
 
     return true;
@@ -94,19 +166,180 @@ bool MemoryMap::mirror(unsigned int start1, unsigned int end1, unsigned int star
 }
 
 bool MemoryMap::clearMirror(unsigned int startaddress, unsigned int endaddress)
+{
+    if(!checkPageRange("clearMirror", startaddress, endaddress)) return false;
+
+    for(unsigned int i = startaddress >> MEMPAGE_SHIFT; i <= (endaddress >> MEMPAGE_SHIFT); i++) resetPage(i, i);
+
+    return true;
+}
+
+bool MemoryMap::setReadOnly(unsigned int startaddress, unsigned int endaddress)
+{
+    if(!checkPageRange("setReadOnly", startaddress, endaddress)) return false;
+
+    for(unsigned int i = startaddress >> MEMPAGE_SHIFT; i <= (endaddress >> MEMPAGE_SHIFT); i++)
+    {
+        m_Pages[i].write = NULL;
+        m_Pages[i].writeHandler = NULL;
+    }
+
+    return true;
+}
+
+bool MemoryMap::mapROM(unsigned int startaddress, unsigned int endaddress, const uint8_t *data)
+{
+    if(!checkPageRange("mapROM", startaddress, endaddress)) return false;
+
+    if(!data)
+    {
+        std::cout << "MemoryMap mapROM error, data is NULL." << std::endl;
+        return false;
+    }
+
+    // bank switching remaps pages often, only the read side is touched
+    for(unsigned int i = startaddress >> MEMPAGE_SHIFT; i <= (endaddress >> MEMPAGE_SHIFT); i++)
+    {
+        m_Pages[i].read = data + ( (i << MEMPAGE_SHIFT) - startaddress);
+        m_Pages[i].readHandler = NULL;
+        m_Pages[i].write = NULL;
+    }
+
+    return true;
+}
+
+bool MemoryMap::mapRAM(unsigned int startaddress, unsigned int endaddress, uint8_t *data)
+{
+    if(!checkPageRange("mapRAM", startaddress, endaddress)) return false;
+
+    if(!data)
+    {
+        std::cout << "MemoryMap mapRAM error, data is NULL." << std::endl;
+        return false;
+    }
+
+    for(unsigned int i = startaddress >> MEMPAGE_SHIFT; i <= (endaddress >> MEMPAGE_SHIFT); i++)
+    {
+        resetPage(i, i);
+
+        m_Pages[i].read = data + ( (i << MEMPAGE_SHIFT) - startaddress);
+        m_Pages[i].write = data + ( (i << MEMPAGE_SHIFT) - startaddress);
+    }
+
+    return true;
+}
+
+bool MemoryMap::mapDevice(const char *caller, unsigned int startaddress, unsigned int endaddress,
+                          MemoryHandler *readhandler, MemoryHandler *writehandler)
 {
     if( startaddress > endaddress)
     {
-        std::cout << "MemoryMap clearMirror error, start address > endaddress." << std::endl;
+        std::cout << "MemoryMap " << caller << " error, start address > endaddress." << std::endl;
         return false;
     }
     if(startaddress >= m_MemSize || endaddress >= m_MemSize)
     {
-        std::cout << "MemoryMap clearMirror error, range outside of memory." << std::endl;
+        std::cout << "MemoryMap " << caller << " error, range outside of memory." << std::endl;
         return false;
     }
+    if(!readhandler && !writehandler)
+    {
+        std::cout << "MemoryMap " << caller << " error, handler is NULL." << std::endl;
+        return false;
+    }
+
+    for(unsigned int i = startaddress >> MEMPAGE_SHIFT; i <= (endaddress >> MEMPAGE_SHIFT); i++)
+    {
+        unsigned int pagestart = i << MEMPAGE_SHIFT;
+        unsigned int pageend = pagestart + MEMPAGE_MASK;
+        MemoryPage &page = m_Pages[i];
 
-    for(unsigned int i = startaddress; i <= endaddress; i++) m_MemMap[i] = &m_Mem[i];
+        // device covers the whole page, handle it directly
+        if(startaddress <= pagestart && endaddress >= pageend && !m_RangeHandlers[i])
+        {
+            if(readhandler)
+            {
+                page.read = NULL;
+                page.readHandler = readhandler;
+            }
+            if(writehandler)
+            {
+                page.write = NULL;
+                page.writeHandler = writehandler;
+            }
+            continue;
+        }
+
+        // device shares the page, dispatch by range with the page memory as fallback
+        if(!m_RangeHandlers[i])
+        {
+            m_RangeHandlers[i] = new MemoryRangeHandler(&m_Mem[pagestart]);
+            page.read = NULL;
+            page.write = NULL;
+            page.readHandler = m_RangeHandlers[i];
+            page.writeHandler = m_RangeHandlers[i];
+        }
+
+        m_RangeHandlers[i]->addRange(startaddress > pagestart ? startaddress : pagestart,
+                                     endaddress < pageend ? endaddress : pageend,
+                                     readhandler, writehandler);
+    }
 
     return true;
 }
+
+bool MemoryMap::mapHandler(unsigned int startaddress, unsigned int endaddress, MemoryHandler *handler)
+{
+    return mapDevice("mapHandler", startaddress, endaddress, handler, handler);
+}
+
+bool MemoryMap::mapReadHandler(unsigned int startaddress, unsigned int endaddress, MemoryHandler *handler)
+{
+    return mapDevice("mapReadHandler", startaddress, endaddress, handler, NULL);
+}
+
+bool MemoryMap::mapWriteHandler(unsigned int startaddress, unsigned int endaddress, MemoryHandler *handler)
+{
+    return mapDevice("mapWriteHandler", startaddress, endaddress, NULL, handler);
+}
+
+/////////////////////////////////////////////
+// RANGE HANDLER
+
+void MemoryRangeHandler::addRange(uint16_t start, uint16_t end, MemoryHandler *readhandler, MemoryHandler *writehandler)
+{
+    Range range;
+
+    range.start = start;
+    range.end = end;
+    range.readHandler = readhandler;
+    range.writeHandler = writehandler;
+
+    m_Ranges.push_back(range);
+}
+
+uint8_t MemoryRangeHandler::memRead(uint16_t address)
+{
+    for(unsigned int i = 0; i < m_Ranges.size(); i++)
+    {
+        const Range &range = m_Ranges[i];
+        if(range.readHandler && address >= range.start && address <= range.end) return range.readHandler->memRead(address);
+    }
+
+    return m_Mem[address & MEMPAGE_MASK];
+}
+
+void MemoryRangeHandler::memWrite(uint16_t address, uint8_t val)
+{
+    for(unsigned int i = 0; i < m_Ranges.size(); i++)
+    {
+        const Range &range = m_Ranges[i];
+        if(range.writeHandler && address >= range.start && address <= range.end)
+        {
+            range.writeHandler->memWrite(address, val);
+            return;
+        }
+    }
+
+    m_Mem[address & MEMPAGE_MASK] = val;
+}
@@ -1,6 +1,11 @@
 #include "nes.hpp"
 
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <iterator>
 
 NES::NES()
 {
@@ -14,23 +19,42 @@ NES::NES()
 
     // rom cartridge
     m_Cartridge = NULL;
+    m_Mapper = NULL;
 
     // init CPU
-    m_CPU = new RP2A03(m_MemCPU->getMap(), MEM_SIZE);
+    m_CPU = new RP2A03(m_MemCPU);
 
     // init PPU
-    m_PPU = new C2C02(m_MemPPU->getMap(), PPUMEM_SIZE);
+    m_PPU = new C2C02(m_MemPPU);
+    m_PPU->connectCPU(m_CPU);
+
+    // init controllers
+    m_Controllers = new ControllerPorts;
+
+    m_Trace = NULL;
+
+    m_Rewind = NULL;
+    m_RewindSeconds = 0;
+    m_RewindBytes = REWIND_DEFAULT_BYTES;
+
+    m_RunAhead = 0;
+    m_RunAheadState = NULL;
 
     reset();
 }
 
 NES::~NES()
 {
+    if(m_Mapper) delete m_Mapper;
     if(m_Cartridge) delete m_Cartridge;
     delete m_MemCPU;
     delete m_MemPPU;
     delete m_CPU;
     delete m_PPU;
+    delete m_Controllers;
+    if(m_Trace) delete m_Trace;
+    if(m_Rewind) delete m_Rewind;
+    if(m_RunAheadState) delete [] m_RunAheadState;
 }
 
 bool NES::init()
@@ -42,19 +66,22 @@ bool NES::init()
     m_MemPPU->clear();
     m_MemPPU->clearMirror(0x0000, PPUMEM_SIZE-1);
 
-    // expose PPU registers to CPU
-    m_PPU->mapRegisters(m_MemCPU->getMap());
+    // expose PPU registers to CPU, includes the register mirrors to 0x3fff
+    m_PPU->mapRegisters(m_MemCPU);
+
+    // APU and controller registers
+    m_CPU->mapRegisters();
+    m_Controllers->mapRegisters(m_MemCPU);
 
     // configure cpu memory mirroring
     m_MemCPU->mirror(0x0000, 0x07ff, 0x0800, 0x0fff);
     m_MemCPU->mirror(0x0000, 0x07ff, 0x1000, 0x17ff);
     m_MemCPU->mirror(0x0000, 0x07ff, 0x1800, 0x1fff);
 
-    // ppu i/o register mirroring (in cpu)
-    for(unsigned int i = 0x2008; i <= 0x3fff; i += 8) m_MemCPU->mirror(0x2000, 0x2007, i, i+7);
-
     // reset processor
     if(!m_CPU->reset()) return false;
+    m_PPU->reset();
+    m_Controllers->reset();
 
     return true;
 }
@@ -64,12 +91,10 @@ void NES::reset()
     if(!m_Cartridge) init();
     else
     {
-        m_MemCPU->write(0x00, 0x6c);
-        m_MemCPU->write(0x01, 0xfc);
-        m_MemCPU->write(0x02, 0xff);
-
+        m_Mapper->reset();
         m_CPU->reset();
-
+        m_PPU->reset();
+        m_Controllers->reset();
     }
 }
 
@@ -77,55 +102,425 @@ bool NES::loadCartridge(std::string romfile)
 {
     std::cout << "Loading cartridge from rom file : " << romfile << std::endl;
 
-    if(m_Cartridge) delete m_Cartridge;
+    unloadCartridge();
 
     m_Cartridge = new Cartridge(romfile);
 
     if(m_Cartridge->loadSuccessful())
     {
-        // clear cpu mirroring
-        // note : some mappers layout mirroring differently
-        m_MemCPU->clearMirror(0x8000, 0xffff);
+        // cartridge board, lays out PRG / CHR banks and mirroring on reset
+        m_Mapper = Mapper::create(m_Cartridge, m_MemCPU, m_MemPPU, m_PPU, m_CPU);
+    }
+
+    if(m_Mapper)
+    {
+        std::cout << "Mapper : " << m_Mapper->getName() << std::endl;
 
-        // clear exisiting CPU memory
-        m_MemCPU->clear(0x8000, 0xffff);
+        // NTSC or PAL clocks
+        m_PPU->setRegion(m_Cartridge->isPAL());
+        m_CPU->setRegion(m_Cartridge->isPAL());
 
-        // PRG RAM 0x6000 - 0x7fff (battery backed persistent ram)
+        // clear PRG RAM 0x6000 - 0x7fff (battery backed persistent ram)
+        m_MemCPU->clear(0x6000, 0x7fff);
 
-        // load PRG ROM from cartridge to CPU memory 0x8000 - 0xffff
-        if(m_Cartridge->getPRGROMSizeByte())
-        {
-            const uint8_t *rom = m_Cartridge->getPRGROM();
-            const uint16_t prgoffset = 0x8000;
+        std::cout << "Successfully loaded ROM : " << romfile << std::endl;
+        reset();
+
+        // state size depends on the cartridge
+        createStateBuffers();
+        return true;
+    }
+    else
+    {
+        std::cout << "### Error loading ROM : " << romfile << std::endl;
+        unloadCartridge();
+    }
+
+    return false;
+}
+
+void NES::unloadCartridge()
+{
+    if(!m_Cartridge) return;
+
+    if(m_Rewind) delete m_Rewind;
+    m_Rewind = NULL;
+
+    if(m_RunAheadState) delete [] m_RunAheadState;
+    m_RunAheadState = NULL;
+
+    // pages reference the rom image, restore plain memory before it goes
+    m_MemCPU->clearMirror(0x8000, 0xffff);
+    m_MemPPU->clearMirror(0x0000, 0x1fff);
+    m_PPU->invalidateTiles(0x0000, 0x1fff);
+
+    if(m_Mapper) delete m_Mapper;
+    m_Mapper = NULL;
+
+    delete m_Cartridge;
+    m_Cartridge = NULL;
+}
+
+bool NES::runFrame()
+{
+    if(!emulateFrame()) return false;
+
+    m_CPU->endAudioFrame();
+
+    if(m_Rewind)
+    {
+        saveState(m_Rewind->getPushBuffer(), getStateSize());
+        m_Rewind->push();
+    }
+
+    if(m_RunAhead && m_RunAheadState)
+    {
+        // the newest rewind state is this frame's, otherwise take a snapshot
+        const uint8_t *state = m_RunAheadState;
+        if(m_Rewind) state = m_Rewind->getCurrent();
+        else saveState(m_RunAheadState, getStateSize());
+
+        // the frame buffer is not part of the state and keeps the last frame run ahead
+        // frames run ahead are never heard, and their instructions are rolled back so they
+        // stay out of the trace
+        bool audio = m_CPU->isAudioEnabled();
+        m_CPU->setAudioEnabled(false);
+        m_CPU->setTrace(NULL);
+
+        for(unsigned int i = 0; i < m_RunAhead; i++)
+            if(!emulateFrame()) break;
+
+        loadState(state, getStateSize());
+
+        m_CPU->setTrace(m_Trace);
+        m_CPU->setAudioEnabled(audio);
+    }
+
+    return true;
+}
+
+bool NES::emulateFrame()
+{
+    uint64_t frame = m_PPU->getFrame();
 
-            std::cout << "Copying PRG ROM to CPU memory." << std::endl;
+    while(m_PPU->getFrame() == frame)
+    {
+        // run the CPU up to whichever event comes first
+        uint64_t target = m_PPU->getNextEventCycle();
+        uint64_t apuevent = m_CPU->getNextAPUEventCycle();
+        if(apuevent < target) target = apuevent;
+
+        uint64_t mapperevent = m_Mapper ? m_Mapper->getNextEventCycle() : NO_EVENT;
+        if(mapperevent < target) target = mapperevent;
+
+        if(!m_CPU->run(target)) return false;
+
+        // sync, raises any nmi or irq due in the slice
+        // the APU is left behind unless its irq is due, register access and the
+        // audio drain at the end of the frame catch it up otherwise
+        m_PPU->catchUp();
+        if(m_CPU->getNextAPUEventCycle() <= m_CPU->getCycles()) m_CPU->catchUpAPU();
+    }
+
+    return true;
+}
+
+// fields of a nestest.log line that are compared, the disassembly and ppu columns are
+// skipped since their layout differs between log versions
+static std::string getTraceFields(const std::string &line)
+{
+    if(line.size() < 16) return line;
+
+    std::string bytes = line.substr(6, 8);
+    bytes.erase(bytes.find_last_not_of(' ') + 1);
+
+    std::string fields = line.substr(0, 4) + " " + bytes;
+
+    size_t regs = line.find("A:");
+    if(regs != std::string::npos) fields += " " + line.substr(regs, 25);
 
-            for(int i = 0; i < 0x8000; i++)  m_MemCPU->write(prgoffset + i, rom[i]);
+    size_t cyc = line.find(" CYC:");
+    if(cyc != std::string::npos && line.find("PPU:") != std::string::npos) fields += line.substr(cyc);
+
+    return fields;
+}
+
+bool NES::runNestest(std::string reflog, std::string tracefile)
+{
+    if(!m_Cartridge)
+    {
+        std::cout << "No cartridge loaded!" << std::endl;
+        return false;
+    }
+
+    std::ifstream ref;
+    if(!reflog.empty())
+    {
+        ref.open(reflog.c_str());
+        if(!ref.is_open())
+        {
+            std::cout << "Error opening reference log " << reflog << std::endl;
+            return false;
+        }
+    }
+
+    std::ofstream trace;
+    if(!tracefile.empty())
+    {
+        trace.open(tracefile.c_str());
+        if(!trace.is_open())
+        {
+            std::cout << "Error opening trace file " << tracefile << std::endl;
+            return false;
         }
+    }
+
+    // automation mode, power up state with the program counter moved to the test entry
+    reset();
+    m_CPU->setProgramCounter(NESTEST_START);
+    m_PPU->catchUp();
+
+    bool match = true;
+    bool completed = false;
+    int lines = 0;
+
+    for(int i = 0; i < NESTEST_MAX_INSTRUCTIONS; i++)
+    {
+        // 0x02 is only written when a test fails, it says nothing unless the tests ran through
+        if(m_CPU->getProgramCounter() == NESTEST_OFFICIAL_END || m_CPU->getProgramCounter() == NESTEST_END) completed = true;
 
-        // load CHR data from cartridge to PPU memory 0x0000 - 0x1fff
-        if(m_Cartridge->getCHRROMSizeByte())
+        std::stringstream ss;
+        ss << m_CPU->getTraceLine() << " PPU:" << std::setw(3) << m_PPU->getScanline() << ",";
+        ss << std::setw(3) << m_PPU->getDot() << " CYC:" << m_CPU->getCycles();
+
+        if(trace.is_open()) trace << ss.str() << std::endl;
+
+        if(ref.is_open())
         {
-            const uint8_t *rom = m_Cartridge->getCHRROM();
+            std::string expected;
+            if(!std::getline(ref, expected)) break;
+            if(!expected.empty() && expected[expected.size() - 1] == '\r') expected.erase(expected.size() - 1);
 
-            std::cout << "Copying CHR ROM to PPU memory." << std::endl;
+            // unofficial opcodes are marked with * and are not implemented
+            if(expected.size() > 15 && expected[15] == '*')
+            {
+                std::cout << "Reference reaches unofficial opcodes at line " << std::dec << lines + 1 << ", stopping." << std::endl;
+                break;
+            }
 
-            for(int i = 0; i < 0x2000; i++) m_MemPPU->write(i, rom[i]);
+            if(getTraceFields(expected) != getTraceFields(ss.str()))
+            {
+                std::cout << "Trace diverges at line " << std::dec << lines + 1 << std::endl;
+                std::cout << "  expected: " << expected << std::endl;
+                std::cout << "  got     : " << ss.str() << std::endl;
+                match = false;
+                break;
+            }
         }
 
+        lines++;
 
-        std::cout << "Successfully loaded ROM : " << romfile << std::endl;
-        reset();
-        return true;
+        if(m_CPU->getProgramCounter() == NESTEST_END) break;
+
+        // step a single instruction
+        if(!m_CPU->run(m_CPU->getCycles() + 1)) break;
+        m_PPU->catchUp();
+        if(m_CPU->getNextAPUEventCycle() <= m_CPU->getCycles()) m_CPU->catchUpAPU();
     }
-    else
+
+    uint8_t official = m_MemCPU->busRead(0x02);
+    uint8_t unofficial = m_MemCPU->busRead(0x03);
+
+    std::cout << "Traced " << std::dec << lines << " instructions";
+    if(ref.is_open() && match) std::cout << ", all matching the reference log";
+    std::cout << "." << std::endl;
+    if(!completed) std::cout << "Stopped before the end of the official opcode tests." << std::endl;
+    std::cout << std::hex << std::setfill('0');
+    std::cout << "Official opcode result   (0x02) = 0x" << std::setw(2) << int(official) << std::endl;
+    std::cout << "Unofficial opcode result (0x03) = 0x" << std::setw(2) << int(unofficial) << std::endl;
+    std::cout << std::dec << std::setfill(' ');
+
+    return match && completed && official == 0x00;
+}
+
+void NES::writeState(StateWriter &state)
+{
+    SaveStateHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SAVESTATE_MAGIC, 4);
+    header.version = SAVESTATE_VERSION;
+    header.mapper = m_Cartridge->getMapperNumber();
+    header.pal = m_Cartridge->isPAL();
+    header.prgromsize = m_Cartridge->getPRGROMSize();
+
+    // size is filled in once everything is written
+    unsigned int start = state.getPosition();
+    state.put(header);
+
+    m_CPU->saveState(state);
+    state.write(m_MemCPU->getMemory(0x0000), 0x0800);
+    state.write(m_MemCPU->getMemory(0x6000), 0x2000);
+    m_PPU->saveState(state);
+    m_Mapper->saveState(state);
+    m_Controllers->saveState(state);
+
+    header.size = state.getPosition() - start;
+    if(state.getData() && !state.overflowed()) memcpy(state.getData() + start, &header, sizeof(header));
+}
+
+unsigned int NES::getStateSize()
+{
+    if(!m_Mapper) return 0;
+
+    StateWriter state(NULL, 0);
+    writeState(state);
+
+    return state.getPosition();
+}
+
+unsigned int NES::saveState(uint8_t *buffer, unsigned int size)
+{
+    if(!m_Mapper) return 0;
+
+    StateWriter state(buffer, size);
+    writeState(state);
+
+    if(state.overflowed())
     {
-        std::cout << "### Error loading ROM : " << romfile << std::endl;
-        delete m_Cartridge;
-        m_Cartridge = NULL;
+        std::cout << "Save state buffer too small, " << std::dec << getStateSize() << " bytes needed." << std::endl;
+        return 0;
     }
 
-    return false;
+    return state.getPosition();
+}
+
+bool NES::loadState(const uint8_t *buffer, unsigned int size)
+{
+    if(!m_Mapper) return false;
+
+    // everything is checked before any component is touched
+    SaveStateHeader header;
+    if(size < sizeof(header)) return false;
+    memcpy(&header, buffer, sizeof(header));
+
+    if(memcmp(header.magic, SAVESTATE_MAGIC, 4) || header.version != SAVESTATE_VERSION)
+    {
+        std::cout << "Unsupported save state." << std::endl;
+        return false;
+    }
+
+    if(header.mapper != m_Cartridge->getMapperNumber() || header.pal != m_Cartridge->isPAL() ||
+       header.prgromsize != m_Cartridge->getPRGROMSize())
+    {
+        std::cout << "Save state is for a different cartridge." << std::endl;
+        return false;
+    }
+
+    if(header.size != getStateSize() || size < header.size)
+    {
+        std::cout << "Save state size mismatch." << std::endl;
+        return false;
+    }
+
+    StateReader state(buffer + sizeof(header), header.size - sizeof(header));
+
+    m_CPU->loadState(state);
+    state.read(m_MemCPU->getMemory(0x0000), 0x0800);
+    state.read(m_MemCPU->getMemory(0x6000), 0x2000);
+    m_PPU->loadState(state);
+    m_Mapper->restoreState(state);
+    m_Controllers->loadState(state);
+
+    return !state.failed();
+}
+
+void NES::createStateBuffers()
+{
+    if(m_Rewind) delete m_Rewind;
+    m_Rewind = NULL;
+
+    if(m_RunAheadState) delete [] m_RunAheadState;
+    m_RunAheadState = NULL;
+
+    if(!m_Mapper) return;
+
+    if(m_RewindSeconds)
+    {
+        unsigned int fps = m_Cartridge->isPAL() ? 50 : 60;
+        m_Rewind = new RewindBuffer(getStateSize(), m_RewindSeconds * fps, m_RewindBytes);
+    }
+
+    if(m_RunAhead) m_RunAheadState = new uint8_t[getStateSize()];
+}
+
+void NES::enableRewind(unsigned int seconds, unsigned int maxbytes)
+{
+    m_RewindSeconds = seconds;
+    m_RewindBytes = maxbytes;
+
+    createStateBuffers();
+}
+
+void NES::setRunAhead(unsigned int frames)
+{
+    m_RunAhead = frames;
+
+    if(m_Mapper && m_RunAhead && !m_RunAheadState) m_RunAheadState = new uint8_t[getStateSize()];
+}
+
+unsigned int NES::rewind(unsigned int frames)
+{
+    if(!m_Rewind || !m_Rewind->getCurrent()) return 0;
+
+    unsigned int rewound = 0;
+    while(rewound < frames && m_Rewind->pop()) rewound++;
+
+    loadState(m_Rewind->getCurrent(), getStateSize());
+
+    return rewound;
+}
+
+void NES::enableTrace(unsigned int records)
+{
+    m_CPU->setTrace(NULL);
+
+    if(m_Trace)
+    {
+        delete m_Trace;
+        m_Trace = NULL;
+    }
+
+    if(records == 0) return;
+
+    m_Trace = new CPUTrace(records);
+    m_CPU->setTrace(m_Trace);
+}
+
+bool NES::saveTrace(std::string filename, unsigned int count)
+{
+    if(!m_Trace)
+    {
+        std::cout << "Tracing is off." << std::endl;
+        return false;
+    }
+
+    return m_Trace->save(filename, count);
+}
+
+double NES::getCPUClockRate()
+{
+    if(m_Cartridge && m_Cartridge->isPAL()) return CPU_CLOCK_PAL;
+    return CPU_CLOCK_NTSC;
+}
+
+unsigned int NES::readAudio(int16_t *samples, unsigned int count)
+{
+    return m_CPU->getAudioRing()->read(samples, count);
+}
+
+void NES::setControllerState(int port, uint8_t buttons)
+{
+    m_Controllers->setButtons(port, buttons);
 }
 
 /////////////////////////////////////////////
@@ -169,11 +564,23 @@ void NES::debugConsole(std::string prompt)
             std::cout << "help - show this menu" << std::endl;
             std::cout << "show - show relevant NES information" << std::endl;
             std::cout << "reset - reset NES" << std::endl;
+            std::cout << "run <frames> - run the NES for a number of frames" << std::endl;
             std::cout << "cpu - enter CPU debug console" << std::endl;
             std::cout << "ppu - enter PPU debug console" << std::endl;
             std::cout << "showrom - show rom/cartridge information" << std::endl;
             std::cout << "unloadrom - unload rom/cartridge" << std::endl;
             std::cout << "loadrom <filename> - load rom/cart from file" << std::endl;
+            std::cout << "savestate <file> - save the machine state to a file" << std::endl;
+            std::cout << "loadstate <file> - load the machine state from a file" << std::endl;
+            std::cout << "runahead <frames> - present frames ahead of the emulated one, 0 for off" << std::endl;
+            std::cout << "audio <on|off> - synthesize audio" << std::endl;
+            std::cout << "rewind on [seconds] - record states every frame for rewinding" << std::endl;
+            std::cout << "rewind off - stop recording states" << std::endl;
+            std::cout << "rewind <frames> - go back a number of frames" << std::endl;
+            std::cout << "trace on [records] - keep the last instructions in a binary trace" << std::endl;
+            std::cout << "trace off - stop tracing" << std::endl;
+            std::cout << "trace save <file> [count] - save the last traced instructions" << std::endl;
+            std::cout << "nestest [reference.log] - run nestest in automation mode and compare its trace" << std::endl;
         }
         else if(words[0] == "show")
         {
@@ -184,6 +591,16 @@ void NES::debugConsole(std::string prompt)
             std::cout << "Resetting NES..." << std::endl;
             reset();
         }
+        else if(words[0] == "run")
+        {
+            int frames = 1;
+            if(words.size() == 2) frames = atoi(words[1].c_str());
+
+            for(int i = 0; i < frames; i++)
+                if(!runFrame()) break;
+
+            std::cout << "Ran " << std::dec << frames << " frames." << std::endl;
+        }
         else if(words[0] == "cpu")
         {
             m_CPU->debugConsole("NES.CPU> ");
@@ -203,8 +620,7 @@ void NES::debugConsole(std::string prompt)
         {
             if(m_Cartridge)
             {
-                delete m_Cartridge;
-                m_Cartridge = NULL;
+                unloadCartridge();
                 std::cout << "Cartridge deleted." << std::endl;
             }
             else std::cout << "No cartridge loaded!" << std::endl;
@@ -218,6 +634,77 @@ void NES::debugConsole(std::string prompt)
             }
             else std::cout << "Invalid parameters!" << std::endl;
         }
+        else if(words[0] == "savestate" && words.size() == 2)
+        {
+            std::vector<uint8_t> buf(getStateSize());
+            unsigned int size = buf.empty() ? 0 : saveState(&buf[0], buf.size());
+
+            std::ofstream ofile(words[1].c_str(), std::ios::binary);
+            if(!size || !ofile.is_open()) std::cout << "Error saving state." << std::endl;
+            else
+            {
+                ofile.write((const char*)&buf[0], size);
+                std::cout << "Saved " << std::dec << size << " bytes to " << words[1] << std::endl;
+            }
+        }
+        else if(words[0] == "loadstate" && words.size() == 2)
+        {
+            std::ifstream ifile(words[1].c_str(), std::ios::binary);
+            std::vector<uint8_t> buf( (std::istreambuf_iterator<char>(ifile)), std::istreambuf_iterator<char>());
+
+            if(buf.empty() || !loadState(&buf[0], buf.size())) std::cout << "Error loading state." << std::endl;
+            else std::cout << "Loaded state from " << words[1] << std::endl;
+        }
+        else if(words[0] == "runahead" && words.size() == 2)
+        {
+            setRunAhead(atoi(words[1].c_str()));
+            std::cout << "Running " << std::dec << m_RunAhead << " frames ahead." << std::endl;
+        }
+        else if(words[0] == "audio" && words.size() == 2)
+        {
+            setAudioEnabled(words[1] == "on");
+            std::cout << "Audio is " << (isAudioEnabled() ? "on." : "off.") << std::endl;
+        }
+        else if(words[0] == "rewind" && words.size() >= 2)
+        {
+            if(words[1] == "on")
+            {
+                unsigned int seconds = REWIND_DEFAULT_SECONDS;
+                if(words.size() == 3) seconds = atoi(words[2].c_str());
+                enableRewind(seconds);
+                std::cout << "Recording " << std::dec << seconds << " seconds of rewind." << std::endl;
+            }
+            else if(words[1] == "off") enableRewind(0);
+            else
+            {
+                unsigned int frames = rewind(atoi(words[1].c_str()));
+                std::cout << "Rewound " << std::dec << frames << " frames, " << getRewindFrames() << " left in ";
+                std::cout << getRewindBytes() << " bytes." << std::endl;
+            }
+        }
+        else if(words[0] == "trace" && words.size() >= 2)
+        {
+            if(words[1] == "on")
+            {
+                unsigned int records = CPUTRACE_DEFAULT_SIZE;
+                if(words.size() == 3) records = atoi(words[2].c_str());
+                enableTrace(records);
+                std::cout << "Tracing the last " << std::dec << m_Trace->getCapacity() << " instructions." << std::endl;
+            }
+            else if(words[1] == "off") enableTrace(0);
+            else if(words[1] == "save" && words.size() >= 3)
+            {
+                unsigned int count = 0;
+                if(words.size() == 4) count = atoi(words[3].c_str());
+                saveTrace(words[2], count);
+            }
+            else std::cout << "Invalid parameters!" << std::endl;
+        }
+        else if(words[0] == "nestest")
+        {
+            if(words.size() == 2) runNestest(words[1], "");
+            else runNestest("", "");
+        }
         else std::cout << "Unknown command - type help" << std::endl;
 
     }
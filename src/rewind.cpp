@@ -0,0 +1,204 @@
+#include "rewind.hpp"
+
+#include <cstring>
+
+RewindBuffer::RewindBuffer(unsigned int statesize, unsigned int maxstates, unsigned int databytes)
+{
+    m_StateSize = statesize;
+
+    m_Current = new uint8_t[m_StateSize];
+    m_Next = new uint8_t[m_StateSize];
+
+    m_DataSize = databytes;
+    m_Data = new uint8_t[m_DataSize];
+
+    // every token after the first is preceded by at least 4 unchanged bytes
+    m_EncodedSize = m_StateSize * 4 + 16;
+    m_Encoded = new uint8_t[m_EncodedSize];
+
+    m_MaxEntries = maxstates ? maxstates : 1;
+    m_Entries = new Entry[m_MaxEntries];
+
+    clear();
+}
+
+RewindBuffer::~RewindBuffer()
+{
+    delete [] m_Current;
+    delete [] m_Next;
+    delete [] m_Data;
+    delete [] m_Encoded;
+    delete [] m_Entries;
+}
+
+void RewindBuffer::clear()
+{
+    m_HasCurrent = false;
+    m_WritePos = 0;
+    m_First = 0;
+    m_Count = 0;
+}
+
+unsigned int RewindBuffer::getUsedBytes()
+{
+    unsigned int used = 0;
+    for(unsigned int i = 0; i < m_Count; i++) used += getEntry(i).size;
+    return used;
+}
+
+void RewindBuffer::dropOldest()
+{
+    m_First = (m_First + 1) % m_MaxEntries;
+    m_Count--;
+}
+
+static inline unsigned int writeCount(uint8_t *out, unsigned int val)
+{
+    unsigned int n = 0;
+    while(val >= 0x80)
+    {
+        out[n++] = (val & 0x7f) | 0x80;
+        val >>= 7;
+    }
+    out[n++] = val;
+    return n;
+}
+
+static inline unsigned int readCount(const uint8_t *in, unsigned int &pos)
+{
+    unsigned int val = 0;
+    unsigned int shift = 0;
+    while(in[pos] & 0x80)
+    {
+        val |= (in[pos++] & 0x7f) << shift;
+        shift += 7;
+    }
+    val |= in[pos++] << shift;
+    return val;
+}
+
+unsigned int RewindBuffer::encode(const uint8_t *state, const uint8_t *prev)
+{
+    unsigned int out = 0;
+    unsigned int i = 0;
+
+    while(i < m_StateSize)
+    {
+        // unchanged bytes, compared a word at a time
+        unsigned int start = i;
+        while(i + 8 <= m_StateSize)
+        {
+            uint64_t a, b;
+            memcpy(&a, state + i, 8);
+            memcpy(&b, prev + i, 8);
+            if(a != b) break;
+            i += 8;
+        }
+        while(i < m_StateSize && state[i] == prev[i]) i++;
+
+        // trailing unchanged bytes need no token
+        if(i == m_StateSize) break;
+
+        unsigned int zeros = i - start;
+
+        // changed bytes, short unchanged gaps stay in the literal
+        unsigned int litstart = i;
+        while(i < m_StateSize)
+        {
+            if(state[i] != prev[i])
+            {
+                i++;
+                continue;
+            }
+
+            unsigned int j = i;
+            while(j < m_StateSize && j < i + 4 && state[j] == prev[j]) j++;
+            if(j - i == 4 || j == m_StateSize) break;
+            i = j;
+        }
+
+        out += writeCount(m_Encoded + out, zeros);
+        out += writeCount(m_Encoded + out, i - litstart);
+        for(unsigned int k = litstart; k < i; k++) m_Encoded[out++] = state[k] ^ prev[k];
+    }
+
+    return out;
+}
+
+void RewindBuffer::apply(const uint8_t *delta, unsigned int size, uint8_t *state)
+{
+    unsigned int in = 0;
+    unsigned int pos = 0;
+
+    while(in < size)
+    {
+        pos += readCount(delta, in);
+        unsigned int literals = readCount(delta, in);
+
+        for(unsigned int k = 0; k < literals; k++) state[pos + k] ^= delta[in + k];
+
+        pos += literals;
+        in += literals;
+    }
+}
+
+void RewindBuffer::push()
+{
+    if(!m_HasCurrent)
+    {
+        uint8_t *swap = m_Current;
+        m_Current = m_Next;
+        m_Next = swap;
+        m_HasCurrent = true;
+        return;
+    }
+
+    // delta that takes the new state back to the current one
+    unsigned int size = encode(m_Current, m_Next);
+
+    // too big to ever fit, older deltas cannot be reached past it
+    if(size > m_DataSize)
+    {
+        m_WritePos = 0;
+        m_First = 0;
+        m_Count = 0;
+    }
+    else
+    {
+        if(m_Count == m_MaxEntries) dropOldest();
+
+        // entries are laid out oldest first after the write position, the tail is freed before wrapping
+        if(m_WritePos + size > m_DataSize)
+        {
+            while(m_Count && getEntry(0).offset >= m_WritePos) dropOldest();
+            m_WritePos = 0;
+        }
+        while(m_Count && getEntry(0).offset >= m_WritePos && getEntry(0).offset < m_WritePos + size) dropOldest();
+
+        memcpy(m_Data + m_WritePos, m_Encoded, size);
+
+        Entry &entry = m_Entries[(m_First + m_Count) % m_MaxEntries];
+        entry.offset = m_WritePos;
+        entry.size = size;
+        m_Count++;
+        m_WritePos += size;
+    }
+
+    uint8_t *swap = m_Current;
+    m_Current = m_Next;
+    m_Next = swap;
+}
+
+bool RewindBuffer::pop()
+{
+    if(!m_HasCurrent || !m_Count) return false;
+
+    Entry &entry = getEntry(m_Count - 1);
+    apply(m_Data + entry.offset, entry.size, m_Current);
+
+    // the newest entry is always the last written, its space is reused
+    m_WritePos = entry.offset;
+    m_Count--;
+
+    return true;
+}
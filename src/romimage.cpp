@@ -0,0 +1,191 @@
+#include "romimage.hpp"
+
+#include <iostream>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+std::map<std::string, ROMImage*> ROMImage::m_Images;
+std::mutex ROMImage::m_ImagesMutex;
+
+ROMImage::ROMImage(std::string filename)
+{
+    m_FileName = filename;
+    m_Data = NULL;
+    m_Size = 0;
+    m_Mapped = false;
+    m_RefCount = 0;
+
+#ifdef _WIN32
+    m_FileHandle = NULL;
+    m_MappingHandle = NULL;
+#endif
+}
+
+ROMImage::~ROMImage()
+{
+    if(!m_Data) return;
+
+    if(!m_Mapped)
+    {
+        delete [] m_Data;
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_Data);
+    CloseHandle( (HANDLE)m_MappingHandle);
+    CloseHandle( (HANDLE)m_FileHandle);
+#else
+    munmap( (void*)m_Data, m_Size);
+#endif
+}
+
+ROMImage *ROMImage::open(std::string filename)
+{
+    std::lock_guard<std::mutex> lock(m_ImagesMutex);
+
+    std::map<std::string, ROMImage*>::iterator it = m_Images.find(filename);
+
+    if(it != m_Images.end())
+    {
+        it->second->m_RefCount++;
+        return it->second;
+    }
+
+    ROMImage *image = new ROMImage(filename);
+
+    if(!image->load())
+    {
+        delete image;
+        return NULL;
+    }
+
+    image->m_RefCount = 1;
+    m_Images[filename] = image;
+
+    return image;
+}
+
+void ROMImage::release()
+{
+    std::lock_guard<std::mutex> lock(m_ImagesMutex);
+
+    if(--m_RefCount) return;
+
+    m_Images.erase(m_FileName);
+    delete this;
+}
+
+bool ROMImage::load()
+{
+    if(mapFile()) return true;
+
+    // file systems without mmap support get a private copy
+    return readFile();
+}
+
+#ifdef _WIN32
+
+bool ROMImage::mapFile()
+{
+    HANDLE file = CreateFileA(m_FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER filesize;
+    if(!GetFileSizeEx(file, &filesize) || filesize.QuadPart == 0 || filesize.QuadPart > 0x7fffffff)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_FileHandle = file;
+    m_MappingHandle = mapping;
+    m_Data = (const uint8_t*)data;
+    m_Size = (unsigned int)filesize.QuadPart;
+    m_Mapped = true;
+
+    return true;
+}
+
+#else
+
+bool ROMImage::mapFile()
+{
+    int fd = ::open(m_FileName.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size == 0 || st.st_size > 0x7fffffff)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping keeps the file referenced
+    close(fd);
+
+    if(data == MAP_FAILED) return false;
+
+    m_Data = (const uint8_t*)data;
+    m_Size = (unsigned int)st.st_size;
+    m_Mapped = true;
+
+    return true;
+}
+
+#endif
+
+bool ROMImage::readFile()
+{
+    std::ifstream ifile;
+
+    ifile.open(m_FileName.c_str(), std::ios::binary | std::ios::in);
+    if(!ifile.is_open()) return false;
+
+    ifile.seekg(0, std::ios::end);
+    std::streamoff filesize = ifile.tellg();
+    ifile.seekg(0, std::ios::beg);
+
+    if(filesize <= 0) return false;
+
+    uint8_t *data = new uint8_t[filesize];
+    ifile.read( (char*)data, filesize);
+
+    if(ifile.gcount() != filesize)
+    {
+        std::cout << "Error reading ROM image " << m_FileName << std::endl;
+        delete [] data;
+        return false;
+    }
+
+    m_Data = data;
+    m_Size = (unsigned int)filesize;
+    m_Mapped = false;
+
+    return true;
+}
@@ -5,14 +5,118 @@
 #include <iomanip>
 #include <fstream>
 
-RP2A03::RP2A03(uint8_t **memory, unsigned int memory_size) : C6502(memory, memory_size)
+RP2A03::RP2A03(MemoryMap *memory) : C6502(memory)
 {
+    m_AudioRing = new AudioRing(AUDIORING_DEFAULT_SIZE);
+    m_AudioEnabled = true;
+    m_APUCycles = 0;
 
+    // mixer levels from the resistor network of the output pins
+    m_PulseTable[0] = 0.0f;
+    for(int i = 1; i < 31; i++) m_PulseTable[i] = 95.52 / (8128.0 / i + 100.0);
+
+    m_TNDTable[0] = 0.0f;
+    for(int i = 1; i < 203; i++) m_TNDTable[i] = 163.67 / (24329.0 / i + 100.0);
+
+    setRegion(false);
+
+    reset();
 }
 
 RP2A03::~RP2A03()
 {
+    delete m_AudioRing;
+}
+
+void RP2A03::mapRegisters()
+{
+    std::cout << "APU registers exposed to CPU memory." << std::endl;
+
+    m_Mem->mapWriteHandler(APU_REG_START, APU_REG_END, this);
+    m_Mem->mapHandler(APU_STATUS, APU_STATUS, this);
+    m_Mem->mapWriteHandler(APU_FRAME_COUNTER, APU_FRAME_COUNTER, this);
+}
+
+bool RP2A03::reset()
+{
+    if(!C6502::reset()) return false;
+
+    for(int i = 0; i < 0x18; i++) m_APURegisters[i] = 0x0;
+
+    m_APUCycles = m_Cycles;
+
+    m_Pulse[0].reset(true);
+    m_Pulse[1].reset(false);
+    m_Triangle.reset();
+    m_Noise.reset();
+    m_DMC.reset();
+
+    m_FrameFiveStep = false;
+    m_FrameIRQInhibit = false;
+    m_FrameIRQ = false;
+    m_FrameCycle = 0;
+    m_FrameStep = 0;
+
+    m_Blip.clear();
+    m_BlipStart = m_APUCycles;
+    m_Output = 0.0f;
+
+    return true;
+}
+
+void RP2A03::saveState(StateWriter &state)
+{
+    C6502::saveState(state);
+
+    state.write(m_APURegisters, sizeof(m_APURegisters));
+    state.put(m_APUCycles);
+    state.put(m_FrameFiveStep);
+    state.put(m_FrameIRQInhibit);
+    state.put(m_FrameIRQ);
+    state.put(m_FrameCycle);
+    state.put(m_FrameStep);
+
+    state.write(m_Pulse, sizeof(m_Pulse));
+    state.write(&m_Triangle, sizeof(m_Triangle));
+    state.write(&m_Noise, sizeof(m_Noise));
+    state.write(&m_DMC, sizeof(m_DMC));
+}
+
+void RP2A03::loadState(StateReader &state)
+{
+    // steps queued so far belong to the old timeline, place them before it is replaced
+    if(m_AudioEnabled) endBlipFrame();
+
+    C6502::loadState(state);
+
+    state.read(m_APURegisters, sizeof(m_APURegisters));
+    state.get(m_APUCycles);
+    state.get(m_FrameFiveStep);
+    state.get(m_FrameIRQInhibit);
+    state.get(m_FrameIRQ);
+    state.get(m_FrameCycle);
+    state.get(m_FrameStep);
+
+    state.read(m_Pulse, sizeof(m_Pulse));
+    state.read(&m_Triangle, sizeof(m_Triangle));
+    state.read(&m_Noise, sizeof(m_Noise));
+    state.read(&m_DMC, sizeof(m_DMC));
+
+    // the next blip frame starts at the loaded cycle, the output steps to the loaded level
+    m_BlipStart = m_APUCycles;
+    updateOutput();
+}
+
+void RP2A03::setRegion(bool pal)
+{
+    m_PAL = pal;
+
+    m_Noise.setRegion(pal);
+    m_DMC.setRegion(pal);
 
+    m_Blip.setRates(pal ? CPU_CLOCK_PAL : CPU_CLOCK_NTSC, AUDIO_SAMPLE_RATE);
+    m_BlipStart = m_APUCycles;
+    m_Output = 0.0f;
 }
 
 void RP2A03::debugConsole(std::string prompt)
@@ -55,7 +159,7 @@ void RP2A03::debugConsole(std::string prompt)
             std::cout << "stepshow - step and show" << std::endl;
             std::cout << "r <addr> [count] - read value at memory address and optional additional bytes" << std::endl;
             std::cout << "w <addr> <byte> - write byte to memory address" << std::endl;
-            std::cout << "reset - clear registers, stack pointer, p counter" << std::endl;
+            std::cout << "reset - reset registers, pc from the reset vector" << std::endl;
             std::cout << "clearmem - clear all memory" << std::endl;
             std::cout << "dumpmem [file] - dump memory, optionally to file" << std::endl;
             std::cout << "loadmem <file> [offset] - load memory from file at optional offset" << std::endl;
@@ -101,7 +205,7 @@ void RP2A03::debugConsole(std::string prompt)
                     if(wval <= 0xff)
                     {
                         std::cout << std::hex << std::setfill('0') << std::setw(4) << addr << " = " << wval << std::endl;
-                        *m_Mem[addr] = uint8_t(wval);
+                        m_Mem->write(addr, uint8_t(wval));
                     }
                     else std::cout << "Value larger than 1 byte!" << std::endl;
                 }
@@ -116,25 +220,25 @@ void RP2A03::debugConsole(std::string prompt)
                 for(int i = 0; i < bcount; i++)
                 {
                     std::cout << std::hex << std::setfill('0') << std::setw(4) << addr+i << ": ";
-                    std::cout << std::setfill('0') << std::setw(2) << int(*m_Mem[addr+i]) << std::endl;
+                    std::cout << std::setfill('0') << std::setw(2) << int(m_Mem->read(addr+i)) << std::endl;
                 }
 
             }
         }
         else if(words[0] == "step")
         {
-            std::cout << "Executing opcode : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
+            std::cout << "Executing opcode : " << std::hex << int(read(m_RegPC)) << std::endl;
             if(!executeNextInstruction() )
             {
-                std::cout << "Opcode undefined : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
+                std::cout << "Opcode undefined : " << std::hex << int(read(m_RegPC)) << std::endl;
             }
         }
         else if(words[0] == "stepshow")
         {
-            std::cout << "Executing opcode : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
-            if(!execute(*m_Mem[m_RegPC]))
+            std::cout << "Executing opcode : " << std::hex << int(read(m_RegPC)) << std::endl;
+            if(!execute(read(m_RegPC)))
             {
-                std::cout << "Opcode undefined : " << std::hex << int(*m_Mem[m_RegPC]) << std::endl;
+                std::cout << "Opcode undefined : " << std::hex << int(read(m_RegPC)) << std::endl;
             }
             show();
         }
@@ -147,7 +251,7 @@ void RP2A03::debugConsole(std::string prompt)
         {
             for(unsigned int i = 0; i < m_MemSize; i++)
             {
-                *m_Mem[i] = 0x0;
+                m_Mem->write(i, 0x0);
             }
         }
         else if(words[0] == "dumpmem")
@@ -158,7 +262,7 @@ void RP2A03::debugConsole(std::string prompt)
                 {
                     std::cout << std::hex << std::setfill('0') << std::setw(4) << i*16 << ": ";
                     for(int n = 0; n < 16; n++)
-                        std::cout << std::hex << std::setfill('0') << std::setw(2) << int(*m_Mem[i*16 + n]) << " ";
+                        std::cout << std::hex << std::setfill('0') << std::setw(2) << int(m_Mem->read(i*16 + n)) << " ";
                     std::cout << std::endl;
                 }
             }
@@ -170,7 +274,7 @@ void RP2A03::debugConsole(std::string prompt)
                 // find last non zero data
                 for(int i = m_MemSize-1; i >= 0; i--)
                 {
-                    if(*m_Mem[i] != 0)
+                    if(m_Mem->read(i) != 0)
                     {
                         lastentry = i;
                         break;
@@ -184,7 +288,7 @@ void RP2A03::debugConsole(std::string prompt)
                 {
 
                     // write all memory to file, stopping at last non-zero address
-                    for(unsigned int i = 0; i <= lastentry; i++) ofile.put( (unsigned char)( int(*m_Mem[i])) );
+                    for(unsigned int i = 0; i <= lastentry; i++) ofile.put( (unsigned char)( int(m_Mem->read(i))) );
                     ofile.close();
                     std::cout << "Wrote " << std::dec << lastentry + 1 << " bytes to " << words[1] << std::endl;
 
@@ -214,7 +318,7 @@ void RP2A03::debugConsole(std::string prompt)
                         uint8_t data = uint8_t(ifile.get());
                         if(!ifile.eof())
                         {
-                            *m_Mem[loffset + bytes] = data;
+                            m_Mem->write(loffset + bytes, data);
                             bytes++;
                         }
                     }
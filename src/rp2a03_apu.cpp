@@ -0,0 +1,309 @@
+#include "rp2a03.hpp"
+
+// frame sequencer steps in cpu cycles, the last entry is where the sequence wraps
+#define FRAME_QUARTER 0x1
+#define FRAME_HALF 0x2
+#define FRAME_IRQ 0x4
+
+static const unsigned int FrameSteps[2][2][6] =
+{
+    // NTSC 4 step, 5 step
+    {{7457, 14913, 22371, 29829, 29830, 0}, {7457, 14913, 22371, 29829, 37281, 37282}},
+    // PAL
+    {{8313, 16627, 24939, 33253, 33254, 0}, {8313, 16627, 24939, 33253, 41565, 41566}}
+};
+
+static const uint8_t FrameActions[2][6] =
+{
+    {FRAME_QUARTER, FRAME_QUARTER | FRAME_HALF, FRAME_QUARTER, FRAME_QUARTER | FRAME_HALF | FRAME_IRQ, 0, 0},
+    {FRAME_QUARTER, FRAME_QUARTER | FRAME_HALF, FRAME_QUARTER, 0, FRAME_QUARTER | FRAME_HALF, 0}
+};
+
+const unsigned int *RP2A03::getFrameSteps()
+{
+    return FrameSteps[m_PAL][m_FrameFiveStep];
+}
+
+void RP2A03::clockQuarterFrame()
+{
+    m_Pulse[0].clockQuarter();
+    m_Pulse[1].clockQuarter();
+    m_Triangle.clockQuarter();
+    m_Noise.clockQuarter();
+}
+
+void RP2A03::clockHalfFrame()
+{
+    m_Pulse[0].clockHalf();
+    m_Pulse[1].clockHalf();
+    m_Triangle.clockHalf();
+    m_Noise.clockHalf();
+}
+
+void RP2A03::clockFrameSequencer()
+{
+    uint8_t actions = FrameActions[m_FrameFiveStep][m_FrameStep];
+
+    if(actions & FRAME_QUARTER) clockQuarterFrame();
+    if(actions & FRAME_HALF) clockHalfFrame();
+
+    if( (actions & FRAME_IRQ) && !m_FrameIRQInhibit)
+    {
+        m_FrameIRQ = true;
+        setIRQLine(IRQ_APU_FRAME, true);
+    }
+
+    // the last step ends the sequence
+    if(m_FrameStep == (m_FrameFiveStep ? 5u : 4u))
+    {
+        m_FrameStep = 0;
+        m_FrameCycle = 0;
+    }
+    else m_FrameStep++;
+}
+
+unsigned int RP2A03::getDMCStolenCycles()
+{
+    // halt, dummy read, alignment and the read itself
+    if(m_APUCycles < m_HaltStart || m_APUCycles >= m_HaltEnd) return 4;
+
+    // inside an OAM DMA the cpu is already halted, only the alignment and read are added
+    // except near the end where the two transfers line up differently
+    if(m_APUCycles == m_HaltEnd - 1) return 3;
+    if(m_APUCycles == m_HaltEnd - 2) return 1;
+    return 2;
+}
+
+void RP2A03::fetchDMCSample(unsigned int stolen)
+{
+    m_DMC.loadSample(m_Mem->busRead(m_DMC.getSampleAddress()));
+
+    // the halt is an adjustment to the cycle count, the APU keeps running through it
+    m_Cycles += stolen;
+
+    if(m_DMC.getIRQ()) setIRQLine(IRQ_APU_DMC, true);
+}
+
+void RP2A03::runAPU(uint64_t target)
+{
+    if(!m_AudioEnabled)
+    {
+        runAPUQuiet(target);
+        return;
+    }
+
+    const unsigned int *steps = getFrameSteps();
+
+    while(m_APUCycles < target)
+    {
+        // jump to whichever comes first, a frame step, a channel timer or the target
+        unsigned int cycles = steps[m_FrameStep] - m_FrameCycle;
+
+        unsigned int timer = m_Pulse[0].getTimer();
+        if(timer < cycles) cycles = timer;
+        timer = m_Pulse[1].getTimer();
+        if(timer < cycles) cycles = timer;
+        timer = m_Triangle.getTimer();
+        if(timer < cycles) cycles = timer;
+        timer = m_Noise.getTimer();
+        if(timer < cycles) cycles = timer;
+        timer = m_DMC.getTimer();
+        if(timer < cycles) cycles = timer;
+
+        if(target - m_APUCycles < cycles) cycles = target - m_APUCycles;
+
+        m_Pulse[0].advance(cycles);
+        m_Pulse[1].advance(cycles);
+        m_Triangle.advance(cycles);
+        m_Noise.advance(cycles);
+        m_DMC.advance(cycles);
+
+        m_APUCycles += cycles;
+        m_FrameCycle += cycles;
+
+        if(m_DMC.needsSample()) fetchDMCSample(getDMCStolenCycles());
+
+        if(m_FrameCycle == steps[m_FrameStep]) clockFrameSequencer();
+
+        updateOutput();
+    }
+}
+
+void RP2A03::runAPUQuiet(uint64_t target)
+{
+    const unsigned int *steps = getFrameSteps();
+
+    while(m_APUCycles < target)
+    {
+        // the dmc timer still runs, its fetches and irq are visible to the game
+        unsigned int cycles = steps[m_FrameStep] - m_FrameCycle;
+
+        unsigned int timer = m_DMC.getTimer();
+        if(timer < cycles) cycles = timer;
+
+        if(target - m_APUCycles < cycles) cycles = target - m_APUCycles;
+
+        m_DMC.advance(cycles);
+
+        m_APUCycles += cycles;
+        m_FrameCycle += cycles;
+
+        if(m_DMC.needsSample()) fetchDMCSample(getDMCStolenCycles());
+
+        if(m_FrameCycle == steps[m_FrameStep]) clockFrameSequencer();
+    }
+}
+
+void RP2A03::catchUpAPU()
+{
+    if(m_Cycles <= m_APUCycles) return;
+
+    runAPU(m_Cycles);
+}
+
+uint64_t RP2A03::getNextAPUEventCycle()
+{
+    uint64_t next = NO_EVENT;
+
+    // frame irq at the end of each 4 step sequence
+    if(!m_FrameFiveStep && !m_FrameIRQInhibit && !m_FrameIRQ)
+    {
+        const unsigned int *steps = getFrameSteps();
+
+        if(m_FrameCycle < steps[3]) next = m_APUCycles + (steps[3] - m_FrameCycle);
+        else next = m_APUCycles + (steps[4] - m_FrameCycle) + steps[3];
+    }
+
+    // dmc sample fetches, the dmc irq is raised by the last one
+    unsigned int cycles = m_DMC.getFetchCycles();
+    if(cycles != APU_NO_TIMER && m_APUCycles + cycles < next) next = m_APUCycles + cycles;
+
+    return next;
+}
+
+void RP2A03::setAudioEnabled(bool enabled)
+{
+    if(enabled == m_AudioEnabled) return;
+
+    // switch at the current cycle
+    catchUpAPU();
+
+    // what was made before switching off is kept for the next read
+    if(!enabled) endBlipFrame();
+
+    m_AudioEnabled = enabled;
+
+    // synthesis picks up from here, stepping to the current level
+    if(m_AudioEnabled)
+    {
+        m_BlipStart = m_APUCycles;
+        updateOutput();
+    }
+}
+
+void RP2A03::endBlipFrame()
+{
+    m_Blip.endFrame(m_APUCycles - m_BlipStart);
+    m_BlipStart = m_APUCycles;
+}
+
+void RP2A03::endAudioFrame()
+{
+    if(!m_AudioEnabled) return;
+
+    catchUpAPU();
+    endBlipFrame();
+
+    int16_t samples[BLIP_MAX_SAMPLES];
+    unsigned int count = m_Blip.readSamples(samples, BLIP_MAX_SAMPLES);
+
+    m_AudioRing->write(samples, count);
+}
+
+uint8_t RP2A03::memRead(uint16_t /*address*/)
+{
+    catchUpAPU();
+
+    // only status is readable, reading it acknowledges the frame irq
+    uint8_t val = 0x0;
+
+    if(m_Pulse[0].isActive()) val |= 0x01;
+    if(m_Pulse[1].isActive()) val |= 0x02;
+    if(m_Triangle.isActive()) val |= 0x04;
+    if(m_Noise.isActive()) val |= 0x08;
+    if(m_DMC.isActive()) val |= 0x10;
+    if(m_FrameIRQ) val |= 0x40;
+    if(m_DMC.getIRQ()) val |= 0x80;
+
+    m_FrameIRQ = false;
+    setIRQLine(IRQ_APU_FRAME, false);
+
+    return val;
+}
+
+void RP2A03::memWrite(uint16_t address, uint8_t val)
+{
+    if(address < APU_REG_START || address > APU_FRAME_COUNTER) return;
+
+    catchUpAPU();
+
+    m_APURegisters[address - APU_REG_START] = val;
+
+    if(address <= 0x4007) m_Pulse[(address >> 2) & 1].write(address & 0x3, val);
+    else if(address <= 0x400b) m_Triangle.write(address & 0x3, val);
+    else if(address <= 0x400f) m_Noise.write(address & 0x3, val);
+    else if(address <= APU_REG_END)
+    {
+        m_DMC.write(address & 0x3, val);
+
+        // irq enable and rate move the dmc fetch prediction
+        if(address == 0x4010)
+        {
+            if(!m_DMC.getIRQ()) setIRQLine(IRQ_APU_DMC, false);
+            endSlice();
+        }
+    }
+    else if(address == APU_STATUS)
+    {
+        m_Pulse[0].setEnabled(val & 0x01);
+        m_Pulse[1].setEnabled(val & 0x02);
+        m_Triangle.setEnabled(val & 0x04);
+        m_Noise.setEnabled(val & 0x08);
+        m_DMC.setEnabled(val & 0x10);
+
+        m_DMC.clearIRQ();
+        setIRQLine(IRQ_APU_DMC, false);
+
+        // a sample started with an empty buffer is read right away, the halt lands on
+        // the write and takes one cycle less
+        if(m_DMC.needsSample()) fetchDMCSample(3);
+
+        endSlice();
+    }
+    // frame counter, writing restarts the sequence
+    else if(address == APU_FRAME_COUNTER)
+    {
+        m_FrameFiveStep = val & 0x80;
+        m_FrameIRQInhibit = val & 0x40;
+        m_FrameCycle = 0;
+        m_FrameStep = 0;
+
+        // 5 step mode clocks the quarter and half frame units straight away
+        if(m_FrameFiveStep)
+        {
+            clockQuarterFrame();
+            clockHalfFrame();
+        }
+
+        // the frame irq prediction moved
+        endSlice();
+
+        if(m_FrameIRQInhibit)
+        {
+            m_FrameIRQ = false;
+            setIRQLine(IRQ_APU_FRAME, false);
+        }
+    }
+
+    updateOutput();
+}
@@ -0,0 +1,122 @@
+#include "tiledecoder.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__)
+
+// bit for each pixel of a row, pixel 0 is bit 7
+static inline __m128i rowBitMask()
+{
+    return _mm_set_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+                        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80);
+}
+
+// lanes holding the bitplane byte of their row -> 0 or val per pixel
+static inline __m128i expandPlane(__m128i rows, __m128i mask, __m128i val)
+{
+    return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(rows, mask), mask), val);
+}
+
+// spread 8 plane bytes so each byte fills the 8 lanes of its row
+// first holds rows 0 - 1, then 2 - 3, 4 - 5, 6 - 7
+static inline void broadcastRows(const uint8_t *plane, __m128i *rows)
+{
+    __m128i b = _mm_loadl_epi64( (const __m128i*)plane);
+    b = _mm_unpacklo_epi8(b, b);
+
+    __m128i lo = _mm_unpacklo_epi16(b, b);
+    __m128i hi = _mm_unpackhi_epi16(b, b);
+
+    rows[0] = _mm_unpacklo_epi32(lo, lo);
+    rows[1] = _mm_unpackhi_epi32(lo, lo);
+    rows[2] = _mm_unpacklo_epi32(hi, hi);
+    rows[3] = _mm_unpackhi_epi32(hi, hi);
+}
+
+void decodeTileRow(uint8_t lo, uint8_t hi, uint8_t *pixels)
+{
+    const __m128i mask = rowBitMask();
+
+    __m128i p = _mm_or_si128(expandPlane(_mm_set1_epi8(lo), mask, _mm_set1_epi8(1)),
+                             expandPlane(_mm_set1_epi8(hi), mask, _mm_set1_epi8(2)) );
+
+    _mm_storel_epi64( (__m128i*)pixels, p);
+}
+
+#else
+
+void decodeTileRow(uint8_t lo, uint8_t hi, uint8_t *pixels)
+{
+    for(int i = 0; i < 8; i++)
+        pixels[i] = ( (lo >> (7 - i)) & 0x1) | ( ( (hi >> (7 - i)) & 0x1) << 1);
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+void decodeTile(const uint8_t *planes, uint8_t *pixels)
+{
+    __m128i lo[4];
+    __m128i hi[4];
+
+    broadcastRows(planes, lo);
+    broadcastRows(planes + 8, hi);
+
+    const __m256i mask = _mm256_set_m128i(rowBitMask(), rowBitMask());
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi8(2);
+
+    // 4 rows per pass
+    for(int i = 0; i < 2; i++)
+    {
+        __m256i l = _mm256_set_m128i(lo[i*2 + 1], lo[i*2]);
+        __m256i h = _mm256_set_m128i(hi[i*2 + 1], hi[i*2]);
+
+        l = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(l, mask), mask), one);
+        h = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(h, mask), mask), two);
+
+        _mm256_storeu_si256( (__m256i*)(pixels + i*32), _mm256_or_si256(l, h));
+    }
+}
+
+const char *getTileDecoderName() { return "AVX2";}
+
+#elif defined(__SSE2__)
+
+void decodeTile(const uint8_t *planes, uint8_t *pixels)
+{
+    __m128i lo[4];
+    __m128i hi[4];
+
+    broadcastRows(planes, lo);
+    broadcastRows(planes + 8, hi);
+
+    const __m128i mask = rowBitMask();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+
+    // 2 rows per pass
+    for(int i = 0; i < 4; i++)
+    {
+        __m128i p = _mm_or_si128(expandPlane(lo[i], mask, one), expandPlane(hi[i], mask, two));
+        _mm_storeu_si128( (__m128i*)(pixels + i*16), p);
+    }
+}
+
+const char *getTileDecoderName() { return "SSE2";}
+
+#else
+
+void decodeTile(const uint8_t *planes, uint8_t *pixels)
+{
+    for(int i = 0; i < 8; i++) decodeTileRow(planes[i], planes[i + 8], pixels + i*8);
+}
+
+const char *getTileDecoderName() { return "scalar";}
+
+#endif